@@ -0,0 +1,193 @@
+// Headless batch runner for balance testing and soak runs. Simulates many
+// independent matches between scripted players across all cores and prints
+// aggregate results.
+//
+//   build/host/batch [-m matches] [-p players] [-t threads] [-s seed]
+//                    [-l tick_limit]
+//
+// Matches are fully determined by the seed, so the summary hash is the same
+// for any thread count.
+
+#include "wasm4.h"
+
+#include "game.h"
+#include "hash.h"
+#include "pool.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_TICK_LIMIT (60 * 60 * 10) // Ten minutes of play
+#define AIM_TOLERANCE 0.1f
+#define CHASE_DISTANCE 60.f
+
+typedef struct {
+  uint32_t ticks;
+  uint32_t hash;
+  uint16_t score[PLAYER_COUNT];
+  int8_t winner;
+  uint8_t players;
+} match_result_t;
+
+typedef struct {
+  uint32_t seed;
+  uint32_t tick_limit;
+  int players; // 0 picks 2-4 per match
+  match_result_t *results;
+} batch_t;
+
+static uint32_t next_random(uint32_t *state) {
+  // xorshift32
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+// A scripted player: turns towards its target, closes in and keeps firing,
+// with the odd random input to break up stalemates.
+static uint8_t bot_pad(const game_t *game, int player, int target,
+                       uint32_t *rng) {
+  const camera_t *camera = &game->cameras[player];
+  const vec3f_t *goal = &game->objects[target].pos;
+  float dx = goal->x - camera->pos.x;
+  float dz = goal->z - camera->pos.z;
+  float delta = atan2f(dz, dx) - camera->yaw;
+  delta = remainderf(delta, 2.f * (float)M_PI);
+
+  uint32_t roll = next_random(rng);
+  if ((roll & 15) == 0) {
+    return (uint8_t)(roll >> 8) &
+           (BUTTON_LEFT | BUTTON_RIGHT | BUTTON_UP | BUTTON_DOWN);
+  }
+
+  uint8_t pad = BUTTON_2;
+  if (delta > AIM_TOLERANCE) {
+    pad |= BUTTON_LEFT;
+  } else if (delta < -AIM_TOLERANCE) {
+    pad |= BUTTON_RIGHT;
+  }
+  if (dx * dx + dz * dz > CHASE_DISTANCE * CHASE_DISTANCE) {
+    pad |= BUTTON_UP;
+  }
+  return pad;
+}
+
+static void run_match(void *ctx, size_t match, int worker) {
+  batch_t *batch = ctx;
+  match_result_t *result = &batch->results[match];
+  uint32_t rng = batch->seed ^ (uint32_t)(match * 0x9e3779b9u);
+  if (rng == 0) {
+    rng = 1;
+  }
+
+  game_t game;
+  memset(&game, 0, sizeof(game));
+  game.tick = next_random(&rng);
+  int players = batch->players;
+  if (players == 0) {
+    players = 2 + (int)(next_random(&rng) % (PLAYER_COUNT - 1));
+  }
+  game.selected_players = (uint8_t)players;
+  init_game(&game);
+  game.state = GAME_STATE_PLAYING;
+
+  int targets[PLAYER_COUNT];
+  for (int i = 0; i < game.selected_players; i++) {
+    targets[i] = (i + 1 + next_random(&rng) % (game.selected_players - 1)) %
+                 game.selected_players;
+  }
+
+  uint8_t pads[PLAYER_COUNT] = {0};
+  uint32_t ticks = 0;
+  while (game.state == GAME_STATE_PLAYING && ticks < batch->tick_limit) {
+    for (int i = 0; i < game.selected_players; i++) {
+      pads[i] = bot_pad(&game, i, targets[i], &rng);
+    }
+    game_update(&game, pads);
+    ticks++;
+  }
+
+  result->ticks = ticks;
+  result->hash = hash_game(&game);
+  result->winner = game.state == GAME_STATE_PLAYING ? -1 : game.winner;
+  result->players = game.selected_players;
+  memcpy(result->score, game.score, sizeof(result->score));
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv) {
+  long matches = 1000;
+  int threads = 0;
+  batch_t batch = {.seed = 1, .tick_limit = DEFAULT_TICK_LIMIT, .players = 2};
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "-m") == 0) {
+      matches = atol(argv[i + 1]);
+    } else if (strcmp(argv[i], "-p") == 0) {
+      batch.players = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "-t") == 0) {
+      threads = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "-s") == 0) {
+      batch.seed = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+    } else if (strcmp(argv[i], "-l") == 0) {
+      batch.tick_limit = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+    } else {
+      break;
+    }
+  }
+  if (matches < 1 || (batch.players != 0 && (batch.players < 2 ||
+                                             batch.players > PLAYER_COUNT))) {
+    fprintf(stderr,
+            "usage: %s [-m matches] [-p players (2-4, 0 for mixed)] "
+            "[-t threads] [-s seed] [-l tick_limit]\n",
+            argv[0]);
+    return 2;
+  }
+
+  batch.results = calloc((size_t)matches, sizeof(match_result_t));
+  pool_t *pool = pool_create(threads);
+  double start = now_seconds();
+  pool_run(pool, (size_t)matches, run_match, &batch);
+  double elapsed = now_seconds() - start;
+
+  long wins[PLAYER_COUNT] = {0};
+  long unfinished = 0;
+  uint64_t ticks = 0;
+  uint32_t summary = HASH_SEED;
+  for (long i = 0; i < matches; i++) {
+    const match_result_t *result = &batch.results[i];
+    ticks += result->ticks;
+    summary = hash_word(summary, result->hash);
+    if (result->winner < 0) {
+      unfinished++;
+    } else {
+      wins[result->winner]++;
+    }
+  }
+
+  printf("%ld matches on %d threads in %.2f s\n", matches, pool_threads(pool),
+         elapsed);
+  for (int i = 0; i < PLAYER_COUNT; i++) {
+    printf("P%d wins: %ld (%.1f%%)\n", i + 1, wins[i],
+           100.0 * wins[i] / matches);
+  }
+  printf("unfinished: %ld\n", unfinished);
+  printf("average length: %.0f ticks\n", (double)ticks / matches);
+  printf("throughput: %.0f ticks/s\n", ticks / elapsed);
+  printf("summary hash: %08x\n", summary);
+
+  pool_destroy(pool);
+  free(batch.results);
+  return 0;
+}
@@ -0,0 +1,241 @@
+// Rendering checks for properties frame hashes alone can't show. Runs
+// scripted matches and menus and exits non-zero if any check fails.
+//
+//   build/host/check
+
+#include "wasm4.h"
+
+#include "game.h"
+#include "render.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define FRAMEBUFFER_SIZE (SCREEN_SIZE * SCREEN_SIZE / 4)
+#define CHECK_TICKS 1200
+#define CHECK_EVERY 7
+
+static uint32_t next_random(uint32_t *state) {
+  // xorshift32
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+// Draws the bands one after the other, binned like the thread pool does.
+static void serial_band_runner(void (*draw_band)(void *ctx, size_t band),
+                               void *ctx, size_t band_count) {
+  for (size_t band = 0; band < band_count; band++) {
+    draw_band(ctx, band);
+  }
+}
+
+static void draw_frame(const game_t *game, band_runner_t runner,
+                       uint8_t *dest) {
+  set_band_runner(runner);
+  memset(FRAMEBUFFER, 0, FRAMEBUFFER_SIZE);
+  host_draw_game(game);
+  memcpy(dest, FRAMEBUFFER, FRAMEBUFFER_SIZE);
+  set_band_runner(NULL);
+}
+
+// Bands clip every polygon to their rows, so a frame drawn in bands must be
+// the one drawn in a single pass, pixel for pixel.
+static int check_bands_match_unbinned(int players, int split_screen,
+                                      uint32_t seed) {
+  static game_t game;
+  static uint8_t unbinned[FRAMEBUFFER_SIZE];
+  static uint8_t banded[FRAMEBUFFER_SIZE];
+  memset(&game, 0, sizeof(game));
+  game.selected_players = (uint8_t)players;
+  game.split_screen = (uint8_t)split_screen;
+  init_game(&game);
+  game.state = GAME_STATE_PLAYING;
+
+  uint8_t pads[PLAYER_COUNT] = {0};
+  for (int tick = 0; tick < CHECK_TICKS; tick++) {
+    for (int i = 0; i < players; i++) {
+      uint32_t r = next_random(&seed);
+      if ((r & 15) == 0) {
+        pads[i] = (uint8_t)(r >> 8) & (BUTTON_1 | BUTTON_LEFT | BUTTON_RIGHT |
+                                       BUTTON_UP | BUTTON_DOWN);
+      }
+    }
+    game_update(&game, pads);
+    if (game.state != GAME_STATE_PLAYING) {
+      break;
+    }
+    if (tick % CHECK_EVERY != 0) {
+      continue;
+    }
+    draw_frame(&game, NULL, unbinned);
+    draw_frame(&game, serial_band_runner, banded);
+    if (memcmp(unbinned, banded, FRAMEBUFFER_SIZE) != 0) {
+      fprintf(stderr, "%d players%s, tick %d: banded frame differs\n",
+              players, split_screen ? " split" : "", (int)game.tick);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Front-to-back order tracks what is drawn in coverage rows as wide as the
+// screen. A small triangle hanging over the right edge must draw and record
+// only its visible pixels, and never touch the coverage past the last row
+// of the clip, which belongs to the next band or to nothing at all. The rows
+// end right before an unmapped page, so a stray access there crashes the
+// check instead of racing with another band.
+static int check_small_tri_at_right_edge(void) {
+  static uint8_t expected[FRAMEBUFFER_SIZE];
+  long page = sysconf(_SC_PAGESIZE);
+  uint8_t *block = mmap(NULL, 2 * page, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (block == MAP_FAILED || mprotect(block + page, page, PROT_NONE) != 0) {
+    perror("guard page");
+    return 0;
+  }
+  // Two rows of clip, the triangle's box 8 x 2 pixels from x = 155.
+  coverage_row_t *rows = (coverage_row_t *)(block + page) - 2;
+  viewport_t strip = {0, 0, SCREEN_SIZE, 2};
+  viewport_t screen = {0, 0, SCREEN_SIZE, SCREEN_SIZE};
+  uint16_t colors = *DRAW_COLORS;
+  *DRAW_COLORS = 0x42;
+  set_clip(&strip);
+
+  memset(FRAMEBUFFER, 0, FRAMEBUFFER_SIZE);
+  tri(155, 0, 162, 1, 155, 1);
+  memcpy(expected, FRAMEBUFFER, FRAMEBUFFER_SIZE);
+
+  memset(FRAMEBUFFER, 0, FRAMEBUFFER_SIZE);
+  memset(rows, 0, 2 * sizeof(coverage_row_t));
+  set_coverage(rows);
+  tri(155, 0, 162, 1, 155, 1);
+  set_coverage(NULL);
+
+  int ok = memcmp(expected, FRAMEBUFFER, FRAMEBUFFER_SIZE) == 0;
+  for (int y = 0; y < 2 && ok; y++) {
+    for (int x = 0; x < SCREEN_SIZE && ok; x++) {
+      int drawn = FRAMEBUFFER[y * SCREEN_SIZE / 4 + x / 4] >> (x % 4 * 2) & 3;
+      int covered = rows[y].words[x / 32] >> (x % 32) & 1;
+      ok = (drawn != 0) == covered;
+    }
+  }
+  if (!ok) {
+    fprintf(stderr, "small triangle at the right edge drawn wrong\n");
+  }
+
+  set_clip(&screen);
+  *DRAW_COLORS = colors;
+  munmap(block, 2 * page);
+  return ok;
+}
+
+// Runs update() the way the runtime does, clearing the framebuffer first
+// unless the last frame asked to keep it.
+static void run_frame(uint8_t pad) {
+  wasm4_memory[0x16] = pad; // GAMEPAD1
+  if (!(*SYSTEM_FLAGS & SYSTEM_PRESERVE_FRAMEBUFFER)) {
+    memset(FRAMEBUFFER, 0, FRAMEBUFFER_SIZE);
+  }
+  update();
+}
+
+// Draws the first frame of a match over a framebuffer holding leftover.
+static void first_play_frame(uint8_t leftover, uint8_t *dest) {
+  memset(FRAMEBUFFER, leftover, FRAMEBUFFER_SIZE);
+  run_frame(BUTTON_1);
+  memcpy(dest, FRAMEBUFFER, FRAMEBUFFER_SIZE);
+}
+
+// Menus keep the framebuffer between frames, so the first frame of a match
+// starts on whatever the last menu frame left. It must come out the same
+// whatever that was. The frame is drawn twice from the same cart state, once
+// in a child process.
+static int check_play_starts_clean(int split_screen) {
+  static uint8_t clean[FRAMEBUFFER_SIZE];
+  static uint8_t dirty[FRAMEBUFFER_SIZE];
+  start();
+  run_frame(0);
+  run_frame(BUTTON_1); // Play, to player select.
+  run_frame(0);
+  if (split_screen) {
+    run_frame(BUTTON_RIGHT);
+    run_frame(0);
+  }
+  if (!(*SYSTEM_FLAGS & SYSTEM_PRESERVE_FRAMEBUFFER)) {
+    fprintf(stderr, "player select doesn't keep the framebuffer\n");
+    return 0;
+  }
+
+  int fds[2];
+  if (pipe(fds) != 0) {
+    perror("pipe");
+    return 0;
+  }
+  pid_t child = fork();
+  if (child < 0) {
+    perror("fork");
+    return 0;
+  }
+  if (child == 0) {
+    close(fds[0]);
+    first_play_frame(0x00, clean);
+    ssize_t written = write(fds[1], clean, FRAMEBUFFER_SIZE);
+    _exit(written == FRAMEBUFFER_SIZE ? 0 : 1);
+  }
+  close(fds[1]);
+  size_t got = 0;
+  while (got < FRAMEBUFFER_SIZE) {
+    ssize_t n = read(fds[0], clean + got, FRAMEBUFFER_SIZE - got);
+    if (n <= 0) {
+      break;
+    }
+    got += (size_t)n;
+  }
+  close(fds[0]);
+  int status;
+  waitpid(child, &status, 0);
+  if (got != FRAMEBUFFER_SIZE || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != 0) {
+    fprintf(stderr, "child frame missing\n");
+    return 0;
+  }
+
+  first_play_frame(0xff, dirty);
+  if (memcmp(clean, dirty, FRAMEBUFFER_SIZE) != 0) {
+    fprintf(stderr, "%sfirst frame of play shows the menu\n",
+            split_screen ? "split screen: " : "");
+    return 0;
+  }
+  return 1;
+}
+
+int main(void) {
+  int ok = check_small_tri_at_right_edge();
+  printf("small triangle at the right edge: %s\n", ok ? "ok" : "FAILED");
+  int failed = !ok;
+
+  ok = 1;
+  for (int players = 2; players <= PLAYER_COUNT && ok; players++) {
+    for (int split = 0; split <= 1 && ok; split++) {
+      ok = check_bands_match_unbinned(players, split, 0x2545f491u * players);
+    }
+  }
+  printf("bands match unbinned: %s\n", ok ? "ok" : "FAILED");
+  failed |= !ok;
+
+  ok = 1;
+  for (int split = 0; split <= 1 && ok; split++) {
+    ok = check_play_starts_clean(split);
+  }
+  printf("play starts clean: %s\n", ok ? "ok" : "FAILED");
+  failed |= !ok;
+  return failed;
+}
@@ -0,0 +1,478 @@
+// Model compiler. Reads meshes in a subset of Wavefront OBJ (v and f lines,
+// polygons are fanned into triangles) and writes the packed C tables that
+// models.c includes. Along the way it merges duplicate vertices, drops
+// degenerate and duplicate triangles, checks that closed meshes are
+// watertight and wound counter-clockwise from outside, and computes the
+// bounding radius and face normals. Closed meshes are flagged for backface
+// culling, and convex ones as needing no sorting of their triangles.
+//
+// A mesh that is meant to be open (a flat sprite, a single triangle) says so
+// with a "# modelc: open" line.
+//
+//   build/host/modelc -o models_data.h models/*.obj
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LINE_LEN 256
+#define MAX_VERTS 256 // uint8 indices
+#define MAX_TRIS 255  // uint8 counts
+#define MAX_INPUT_VERTS 1024
+#define MAX_INPUT_TRIS 1024
+#define OUTPUT_WIDTH 80
+
+typedef struct {
+  double x, y, z;
+} vec3d_t;
+
+typedef struct {
+  int x, y, z;
+} vec3i_t;
+
+typedef struct {
+  const char *path;
+  char name[64];
+  int open;
+  int convex;
+
+  vec3d_t in_verts[MAX_INPUT_VERTS];
+  int in_verts_count;
+  int in_tris[MAX_INPUT_TRIS][3];
+  int in_tris_count;
+
+  double scale;
+  vec3i_t verts[MAX_VERTS];
+  int verts_count;
+  int tris[MAX_TRIS][3];
+  int tris_count;
+  vec3i_t normals[MAX_TRIS];
+  double radius;
+
+  int merged;
+  int degenerate;
+  int duplicate;
+} mesh_t;
+
+static const char *error_path;
+static int error_line;
+
+static void fail(const char *message, const char *detail) {
+  fprintf(stderr, "%s", error_path);
+  if (error_line > 0) {
+    fprintf(stderr, ":%d", error_line);
+  }
+  fprintf(stderr, ": %s%s\n", message, detail);
+  exit(1);
+}
+
+// Parses one "f" index, which may be "v", "v/vt", "v//vn" or "v/vt/vn", and
+// may count back from the last vertex when negative.
+static int parse_index(const char *token, int verts_count) {
+  int index = atoi(token);
+  if (index < 0) {
+    index += verts_count + 1;
+  }
+  if (index < 1 || index > verts_count) {
+    fail("face refers to a missing vertex: ", token);
+  }
+  return index - 1;
+}
+
+static void load_obj(mesh_t *mesh, const char *path) {
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    fail("cannot open", "");
+  }
+
+  const char *base = strrchr(path, '/');
+  base = (base == NULL) ? path : base + 1;
+  size_t name_len = strcspn(base, ".");
+  if (name_len == 0 || name_len >= sizeof(mesh->name)) {
+    fail("bad model name", "");
+  }
+  memcpy(mesh->name, base, name_len);
+  mesh->name[name_len] = '\0';
+  mesh->path = path;
+
+  char line[LINE_LEN];
+  error_line = 0;
+  while (fgets(line, sizeof(line), file) != NULL) {
+    error_line++;
+    if (strncmp(line, "# modelc: open", 14) == 0) {
+      mesh->open = 1;
+    } else if (strncmp(line, "v ", 2) == 0) {
+      if (mesh->in_verts_count >= MAX_INPUT_VERTS) {
+        fail("too many vertices", "");
+      }
+      vec3d_t *v = &mesh->in_verts[mesh->in_verts_count++];
+      if (sscanf(line + 2, "%lf %lf %lf", &v->x, &v->y, &v->z) != 3) {
+        fail("bad vertex", "");
+      }
+    } else if (strncmp(line, "f ", 2) == 0) {
+      int polygon[16];
+      int count = 0;
+      for (char *token = strtok(line + 2, " \t\r\n"); token != NULL;
+           token = strtok(NULL, " \t\r\n")) {
+        if (count >= 16) {
+          fail("face has too many vertices", "");
+        }
+        polygon[count++] = parse_index(token, mesh->in_verts_count);
+      }
+      if (count < 3) {
+        fail("face has fewer than 3 vertices", "");
+      }
+      for (int i = 1; i + 1 < count; i++) {
+        if (mesh->in_tris_count >= MAX_INPUT_TRIS) {
+          fail("too many faces", "");
+        }
+        int *tri = mesh->in_tris[mesh->in_tris_count++];
+        tri[0] = polygon[0];
+        tri[1] = polygon[i];
+        tri[2] = polygon[i + 1];
+      }
+    }
+  }
+  fclose(file);
+  error_line = 0;
+}
+
+// Picks the coarsest power-of-two step that represents every coordinate
+// exactly in int8. Meshes that don't fit are quantized to their extent,
+// with a warning.
+static void choose_scale(mesh_t *mesh) {
+  double extent = 0.0;
+  for (int i = 0; i < mesh->in_verts_count; i++) {
+    const double *c = &mesh->in_verts[i].x;
+    for (int k = 0; k < 3; k++) {
+      extent = fmax(extent, fabs(c[k]));
+    }
+  }
+  for (double step = 1.0; step >= 1.0 / 64; step /= 2) {
+    int exact = extent / step <= 127.0;
+    for (int i = 0; i < mesh->in_verts_count && exact; i++) {
+      const double *c = &mesh->in_verts[i].x;
+      for (int k = 0; k < 3; k++) {
+        double q = c[k] / step;
+        exact = exact && fabs(q - round(q)) < 1e-6;
+      }
+    }
+    if (exact) {
+      mesh->scale = step;
+      return;
+    }
+  }
+  mesh->scale = extent > 0.0 ? extent / 127.0 : 1.0;
+  fprintf(stderr, "%s: warning: coordinates quantized to steps of %g\n",
+          mesh->path, mesh->scale);
+}
+
+static int same_vec3i(const vec3i_t *a, const vec3i_t *b) {
+  return a->x == b->x && a->y == b->y && a->z == b->z;
+}
+
+static vec3i_t sub(const vec3i_t *a, const vec3i_t *b) {
+  vec3i_t r = {a->x - b->x, a->y - b->y, a->z - b->z};
+  return r;
+}
+
+static vec3d_t face_cross(const mesh_t *mesh, const int *tri) {
+  vec3i_t e1 = sub(&mesh->verts[tri[1]], &mesh->verts[tri[0]]);
+  vec3i_t e2 = sub(&mesh->verts[tri[2]], &mesh->verts[tri[0]]);
+  vec3d_t n = {(double)e1.y * e2.z - (double)e1.z * e2.y,
+               (double)e1.z * e2.x - (double)e1.x * e2.z,
+               (double)e1.x * e2.y - (double)e1.y * e2.x};
+  return n;
+}
+
+static int same_triangle(const int *a, const int *b) {
+  int matched = 0;
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      if (a[i] == b[j]) {
+        matched++;
+        break;
+      }
+    }
+  }
+  return matched == 3;
+}
+
+static void optimize(mesh_t *mesh) {
+  // Quantize and merge vertices that land on the same position.
+  int remap[MAX_INPUT_VERTS];
+  for (int i = 0; i < mesh->in_verts_count; i++) {
+    const vec3d_t *v = &mesh->in_verts[i];
+    vec3i_t q = {(int)round(v->x / mesh->scale), (int)round(v->y / mesh->scale),
+                 (int)round(v->z / mesh->scale)};
+    int found = -1;
+    for (int j = 0; j < mesh->verts_count && found < 0; j++) {
+      if (same_vec3i(&mesh->verts[j], &q)) {
+        found = j;
+      }
+    }
+    if (found >= 0) {
+      mesh->merged++;
+    } else {
+      if (mesh->verts_count >= MAX_VERTS) {
+        fail("more than 256 vertices", "");
+      }
+      found = mesh->verts_count++;
+      mesh->verts[found] = q;
+    }
+    remap[i] = found;
+  }
+
+  // Keep the triangles in order, minus degenerate and repeated ones. A
+  // triangle listed again with the opposite winding is a repeat too.
+  for (int i = 0; i < mesh->in_tris_count; i++) {
+    int tri[3];
+    for (int k = 0; k < 3; k++) {
+      tri[k] = remap[mesh->in_tris[i][k]];
+    }
+    vec3d_t n = face_cross(mesh, tri);
+    if (n.x == 0.0 && n.y == 0.0 && n.z == 0.0) {
+      mesh->degenerate++;
+      continue;
+    }
+    int repeated = 0;
+    for (int j = 0; j < mesh->tris_count && !repeated; j++) {
+      repeated = same_triangle(mesh->tris[j], tri);
+    }
+    if (repeated) {
+      mesh->duplicate++;
+      continue;
+    }
+    if (mesh->tris_count >= MAX_TRIS) {
+      fail("more than 255 triangles", "");
+    }
+    memcpy(mesh->tris[mesh->tris_count++], tri, sizeof(tri));
+  }
+
+  // Drop vertices no triangle uses any more, keeping the order.
+  int used[MAX_VERTS] = {0};
+  for (int i = 0; i < mesh->tris_count; i++) {
+    for (int k = 0; k < 3; k++) {
+      used[mesh->tris[i][k]] = 1;
+    }
+  }
+  int compact[MAX_VERTS];
+  int count = 0;
+  for (int i = 0; i < mesh->verts_count; i++) {
+    if (used[i]) {
+      compact[i] = count;
+      mesh->verts[count++] = mesh->verts[i];
+    } else {
+      mesh->merged++;
+    }
+  }
+  mesh->verts_count = count;
+  for (int i = 0; i < mesh->tris_count; i++) {
+    for (int k = 0; k < 3; k++) {
+      mesh->tris[i][k] = compact[mesh->tris[i][k]];
+    }
+  }
+}
+
+// Closed meshes use every edge exactly once in each direction. Anything
+// else is a hole or a flipped face.
+static void check_closed(const mesh_t *mesh) {
+  static uint8_t edges[MAX_VERTS][MAX_VERTS];
+  memset(edges, 0, sizeof(edges));
+  char detail[64];
+  for (int i = 0; i < mesh->tris_count; i++) {
+    for (int k = 0; k < 3; k++) {
+      int a = mesh->tris[i][k];
+      int b = mesh->tris[i][(k + 1) % 3];
+      if (edges[a][b]++) {
+        snprintf(detail, sizeof(detail), "%d-%d (triangle %d)", a + 1, b + 1,
+                 i + 1);
+        fail("inconsistent winding, edge used twice in one direction: ",
+             detail);
+      }
+    }
+  }
+  for (int a = 0; a < mesh->verts_count; a++) {
+    for (int b = 0; b < mesh->verts_count; b++) {
+      if (edges[a][b] && !edges[b][a]) {
+        snprintf(detail, sizeof(detail), "%d-%d", a + 1, b + 1);
+        fail("mesh is not closed, open edge: ", detail);
+      }
+    }
+  }
+
+  // The signed volume is positive when faces wind counter-clockwise seen
+  // from outside.
+  double volume = 0.0;
+  for (int i = 0; i < mesh->tris_count; i++) {
+    const vec3i_t *a = &mesh->verts[mesh->tris[i][0]];
+    vec3d_t n = face_cross(mesh, mesh->tris[i]);
+    volume += a->x * n.x + a->y * n.y + a->z * n.z;
+  }
+  if (volume <= 0.0) {
+    fail("faces wind clockwise seen from outside", "");
+  }
+}
+
+// A closed mesh is convex when no vertex lies in front of any face's plane.
+static int is_convex(const mesh_t *mesh) {
+  for (int i = 0; i < mesh->tris_count; i++) {
+    const vec3i_t *a = &mesh->verts[mesh->tris[i][0]];
+    vec3d_t n = face_cross(mesh, mesh->tris[i]);
+    for (int j = 0; j < mesh->verts_count; j++) {
+      vec3i_t d = sub(&mesh->verts[j], a);
+      if (d.x * n.x + d.y * n.y + d.z * n.z > 0.0) {
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+static void compute_bounds(mesh_t *mesh) {
+  double radius = 0.0;
+  for (int i = 0; i < mesh->verts_count; i++) {
+    const vec3i_t *v = &mesh->verts[i];
+    radius = fmax(radius, sqrt((double)v->x * v->x + (double)v->y * v->y +
+                               (double)v->z * v->z));
+  }
+  // Rounded up so the emitted radius still bounds the mesh.
+  mesh->radius = ceil(radius * mesh->scale * 1e4) / 1e4;
+
+  for (int i = 0; i < mesh->tris_count; i++) {
+    vec3d_t n = face_cross(mesh, mesh->tris[i]);
+    double len = sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+    vec3i_t q = {(int)round(n.x / len * 127), (int)round(n.y / len * 127),
+                 (int)round(n.z / len * 127)};
+    mesh->normals[i] = q;
+  }
+}
+
+// Writes comma-separated items, wrapping lines at OUTPUT_WIDTH.
+static void emit_item(FILE *out, const char *item, int *column, int last) {
+  int len = (int)strlen(item) + (last ? 0 : 1);
+  if (*column + len + 1 > OUTPUT_WIDTH) {
+    fprintf(out, "\n   ");
+    *column = 3;
+  }
+  fprintf(out, " %s%s", item, last ? "" : ",");
+  *column += len + 1;
+}
+
+static void emit_vec3i_array(FILE *out, const char *name, const char *suffix,
+                             const vec3i_t *v, int count) {
+  fprintf(out, "static const vec3q_t %s_%s[%d] = {\n   ", name, suffix,
+          count);
+  int column = 3;
+  for (int i = 0; i < count; i++) {
+    char item[32];
+    snprintf(item, sizeof(item), "{%d, %d, %d}", v[i].x, v[i].y, v[i].z);
+    emit_item(out, item, &column, i == count - 1);
+  }
+  fprintf(out, "};\n");
+}
+
+// Formats a float literal such as "1.f" or "16.6734f".
+static void format_float(char *dest, size_t len, double value) {
+  snprintf(dest, len, "%g", value);
+  if (strpbrk(dest, ".e") == NULL) {
+    strncat(dest, ".", len - strlen(dest) - 1);
+  }
+  strncat(dest, "f", len - strlen(dest) - 1);
+}
+
+static void emit_mesh(FILE *out, const mesh_t *mesh) {
+  char macro[64];
+  size_t i;
+  for (i = 0; mesh->name[i] != '\0'; i++) {
+    macro[i] = (char)(mesh->name[i] >= 'a' && mesh->name[i] <= 'z'
+                          ? mesh->name[i] - 'a' + 'A'
+                          : mesh->name[i]);
+  }
+  macro[i] = '\0';
+
+  fprintf(out, "\n// %s: %d vertices, %d triangles\n", mesh->path,
+          mesh->verts_count, mesh->tris_count);
+  emit_vec3i_array(out, mesh->name, "verts", mesh->verts, mesh->verts_count);
+  fprintf(out, "static const uint8_t %s_tris[%d * 3] = {\n   ", mesh->name,
+          mesh->tris_count);
+  int column = 3;
+  for (int t = 0; t < mesh->tris_count; t++) {
+    char item[16];
+    snprintf(item, sizeof(item), "%d, %d, %d", mesh->tris[t][0],
+             mesh->tris[t][1], mesh->tris[t][2]);
+    emit_item(out, item, &column, t == mesh->tris_count - 1);
+  }
+  fprintf(out, "};\n");
+  emit_vec3i_array(out, mesh->name, "normals", mesh->normals,
+                   mesh->tris_count);
+  char scale[32];
+  char radius[32];
+  format_float(scale, sizeof(scale), mesh->scale);
+  format_float(radius, sizeof(radius), mesh->radius);
+  const char *flags = mesh->open     ? "0"
+                      : mesh->convex ? "MODEL_CLOSED | MODEL_CONVEX"
+                                     : "MODEL_CLOSED";
+  fprintf(out,
+          "#define %s_MESH \\\n"
+          "  .verts = %s_verts, .tris = %s_tris, .normals = %s_normals, \\\n"
+          "  .tris_count = %d, .verts_count = %d, .vert_scale = %s, \\\n"
+          "  .radius = %s, .flags = %s\n",
+          macro, mesh->name, mesh->name, mesh->name, mesh->tris_count,
+          mesh->verts_count, scale, radius, flags);
+}
+
+int main(int argc, char **argv) {
+  const char *out_path = NULL;
+  int first = 1;
+  if (argc > 2 && strcmp(argv[1], "-o") == 0) {
+    out_path = argv[2];
+    first = 3;
+  }
+  if (out_path == NULL || first >= argc) {
+    fprintf(stderr, "usage: %s -o output.h model.obj...\n", argv[0]);
+    return 1;
+  }
+
+  static mesh_t meshes[32];
+  int count = argc - first;
+  if (count > (int)(sizeof(meshes) / sizeof(meshes[0]))) {
+    fprintf(stderr, "%s: too many models\n", argv[0]);
+    return 1;
+  }
+  for (int i = 0; i < count; i++) {
+    mesh_t *mesh = &meshes[i];
+    error_path = argv[first + i];
+    load_obj(mesh, argv[first + i]);
+    choose_scale(mesh);
+    optimize(mesh);
+    if (!mesh->open) {
+      check_closed(mesh);
+      mesh->convex = is_convex(mesh);
+    }
+    compute_bounds(mesh);
+    printf("%s: %d vertices, %d triangles%s", mesh->path, mesh->verts_count,
+           mesh->tris_count,
+           mesh->open ? ", open" : mesh->convex ? ", convex" : "");
+    if (mesh->merged || mesh->degenerate || mesh->duplicate) {
+      printf(" (%d vertices merged or unused, %d degenerate and %d "
+             "duplicate triangles removed)",
+             mesh->merged, mesh->degenerate, mesh->duplicate);
+    }
+    printf("\n");
+  }
+
+  FILE *out = fopen(out_path, "w");
+  if (out == NULL) {
+    fprintf(stderr, "%s: cannot write\n", out_path);
+    return 1;
+  }
+  fprintf(out, "// Generated by host/modelc.c. Do not edit.\n");
+  for (int i = 0; i < count; i++) {
+    emit_mesh(out, &meshes[i]);
+  }
+  fclose(out);
+  return 0;
+}
@@ -0,0 +1,173 @@
+#include "pool.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// The unclaimed tasks of one worker, [begin, end). The owner takes from the
+// end, thieves from the beginning.
+typedef struct {
+  pthread_mutex_t lock;
+  size_t begin;
+  size_t end;
+} pool_deque_t;
+
+struct pool_s {
+  int threads;
+  pthread_t *handles;
+  pool_deque_t *deques;
+
+  pthread_mutex_t lock;
+  pthread_cond_t start;
+  pthread_cond_t done;
+  unsigned generation; // Bumped by every pool_run()
+  int busy;            // Helper threads still working on the current run
+  int stopping;
+
+  pool_task_t fn;
+  void *ctx;
+};
+
+typedef struct {
+  pool_t *pool;
+  int worker;
+} pool_worker_t;
+
+static int pop_own(pool_deque_t *deque, size_t *task) {
+  int found = 0;
+  pthread_mutex_lock(&deque->lock);
+  if (deque->begin < deque->end) {
+    *task = --deque->end;
+    found = 1;
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return found;
+}
+
+static int steal(pool_deque_t *deque, size_t *task) {
+  int found = 0;
+  pthread_mutex_lock(&deque->lock);
+  if (deque->begin < deque->end) {
+    *task = deque->begin++;
+    found = 1;
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return found;
+}
+
+// Runs tasks until every deque is empty. Nothing adds tasks during a run,
+// so one full pass of failed steals means the worker is done.
+static void work(pool_t *pool, int worker) {
+  size_t task;
+  for (;;) {
+    int found = pop_own(&pool->deques[worker], &task);
+    for (int i = 1; !found && i < pool->threads; i++) {
+      found = steal(&pool->deques[(worker + i) % pool->threads], &task);
+    }
+    if (!found) {
+      return;
+    }
+    pool->fn(pool->ctx, task, worker);
+  }
+}
+
+static void *worker_main(void *arg) {
+  pool_worker_t *self = arg;
+  pool_t *pool = self->pool;
+  unsigned seen = 0;
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (pool->generation == seen && !pool->stopping) {
+      pthread_cond_wait(&pool->start, &pool->lock);
+    }
+    if (pool->stopping) {
+      break;
+    }
+    seen = pool->generation;
+    pthread_mutex_unlock(&pool->lock);
+
+    work(pool, self->worker);
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->busy == 0) {
+      pthread_cond_signal(&pool->done);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+  free(self);
+  return NULL;
+}
+
+pool_t *pool_create(int threads) {
+  if (threads <= 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? (int)cpus : 1;
+  }
+
+  pool_t *pool = calloc(1, sizeof(pool_t));
+  pool->threads = threads;
+  pool->handles = calloc(threads, sizeof(pthread_t));
+  pool->deques = calloc(threads, sizeof(pool_deque_t));
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->start, NULL);
+  pthread_cond_init(&pool->done, NULL);
+  for (int i = 0; i < threads; i++) {
+    pthread_mutex_init(&pool->deques[i].lock, NULL);
+  }
+
+  // Worker 0 is whichever thread calls pool_run().
+  for (int i = 1; i < threads; i++) {
+    pool_worker_t *self = malloc(sizeof(pool_worker_t));
+    self->pool = pool;
+    self->worker = i;
+    pthread_create(&pool->handles[i], NULL, worker_main, self);
+  }
+  return pool;
+}
+
+void pool_destroy(pool_t *pool) {
+  pthread_mutex_lock(&pool->lock);
+  pool->stopping = 1;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (int i = 1; i < pool->threads; i++) {
+    pthread_join(pool->handles[i], NULL);
+  }
+  for (int i = 0; i < pool->threads; i++) {
+    pthread_mutex_destroy(&pool->deques[i].lock);
+  }
+  pthread_cond_destroy(&pool->done);
+  pthread_cond_destroy(&pool->start);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool->deques);
+  free(pool->handles);
+  free(pool);
+}
+
+int pool_threads(const pool_t *pool) { return pool->threads; }
+
+void pool_run(pool_t *pool, size_t task_count, pool_task_t fn, void *ctx) {
+  size_t threads = (size_t)pool->threads;
+  for (size_t i = 0; i < threads; i++) {
+    pool->deques[i].begin = task_count * i / threads;
+    pool->deques[i].end = task_count * (i + 1) / threads;
+  }
+  pool->fn = fn;
+  pool->ctx = ctx;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->busy = pool->threads - 1;
+  pool->generation++;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->lock);
+
+  work(pool, 0);
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->busy > 0) {
+    pthread_cond_wait(&pool->done, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
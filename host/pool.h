@@ -0,0 +1,23 @@
+#ifndef POOL_H_INCLUDED
+#define POOL_H_INCLUDED
+
+#include <stddef.h>
+
+// Work-stealing thread pool for the native tools. pool_run() hands each
+// worker an equal slice of the task indices; a worker runs its own slice
+// from the back and, once it is empty, steals from the front of the others.
+typedef struct pool_s pool_t;
+
+// worker is in [0, pool_threads()) and lets tasks use per-worker scratch.
+typedef void (*pool_task_t)(void *ctx, size_t task, int worker);
+
+// threads <= 0 uses one thread per online CPU. The calling thread counts as
+// one of them.
+pool_t *pool_create(int threads);
+void pool_destroy(pool_t *pool);
+int pool_threads(const pool_t *pool);
+
+// Runs fn for every task in [0, task_count) and returns once all are done.
+void pool_run(pool_t *pool, size_t task_count, pool_task_t fn, void *ctx);
+
+#endif
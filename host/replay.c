@@ -0,0 +1,249 @@
+// Headless replay runner. Reads a WASM-4 console log, finds the replays the
+// cart traced at the end of each match, keeping the last trace of each, and
+// plays them back through game_update() as fast as the CPU allows, without
+// rendering unless -r is given.
+//
+//   build/host/replay [-n repeats] [-r] [-t threads] console.log
+
+#include "game.h"
+#include "hash.h"
+#include "pool.h"
+#include "render.h"
+#include "replay.h"
+#include "wasm4.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LINE_LEN 256
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+// Appends the bytes of one "replay <hex>" line. Returns 0 on malformed input.
+static int parse_hex(const char *hex, uint8_t *data, size_t *len) {
+  while (hex[0] != '\0' && hex[0] != '\n' && hex[0] != '\r') {
+    int hi = hex_value(hex[0]);
+    int lo = hex_value(hex[1]);
+    if (hi < 0 || lo < 0 || *len >= REPLAY_BUFFER_LEN) {
+      return 0;
+    }
+    data[(*len)++] = (uint8_t)(hi << 4 | lo);
+    hex += 2;
+  }
+  return 1;
+}
+
+// A replay found in the log.
+typedef struct {
+  uint8_t data[REPLAY_BUFFER_LEN];
+  size_t len;
+} logged_replay_t;
+
+static logged_replay_t *replays = NULL;
+static int replay_count = 0;
+
+// Tick a replay's match started on, or -1 if its header is bad.
+static int64_t replay_seed(const logged_replay_t *replay) {
+  replay_player_t player;
+  if (!replay_open(&player, replay->data, replay->len)) {
+    return -1;
+  }
+  return player.seed_tick;
+}
+
+// Keeps a replay read from the log. Rollback can re-run the tick a match
+// ended on and trace the match again; only the last trace of a match, found
+// by the tick it started on, is final, so it takes the place of the earlier
+// ones.
+static int keep_replay(const logged_replay_t *replay) {
+  int64_t seed = replay_seed(replay);
+  for (int i = 0; i < replay_count && seed >= 0; i++) {
+    if (replay_seed(&replays[i]) == seed) {
+      replays[i] = *replay;
+      return 1;
+    }
+  }
+  logged_replay_t *grown =
+      realloc(replays, (replay_count + 1) * sizeof(logged_replay_t));
+  if (grown == NULL) {
+    return 0;
+  }
+  replays = grown;
+  replays[replay_count++] = *replay;
+  return 1;
+}
+
+static pool_t *pool = NULL;
+
+typedef struct {
+  void (*draw_band)(void *ctx, size_t band);
+  void *ctx;
+} band_task_t;
+
+static void run_band(void *ctx, size_t task, int worker) {
+  (void)worker;
+  const band_task_t *bands = (const band_task_t *)ctx;
+  bands->draw_band(bands->ctx, task);
+}
+
+// Rasterizes the bands of a view on the pool.
+static void pool_band_runner(void (*draw_band)(void *ctx, size_t band),
+                             void *ctx, size_t band_count) {
+  band_task_t bands = {draw_band, ctx};
+  pool_run(pool, band_count, run_band, &bands);
+}
+
+// Draws a frame like the runtime does: cleared first unless the cart asked
+// to keep it. Returns the hash of the frame folded into hash.
+static uint32_t render_frame(const game_t *game, uint32_t hash) {
+  if (!(*SYSTEM_FLAGS & SYSTEM_PRESERVE_FRAMEBUFFER)) {
+    memset(FRAMEBUFFER, 0, SCREEN_SIZE * SCREEN_SIZE / 4);
+  }
+  if (game->state == GAME_STATE_PLAYING) {
+    host_draw_game(game);
+  }
+  for (size_t i = 0; i < SCREEN_SIZE * SCREEN_SIZE / 4; i += 4) {
+    uint32_t word;
+    memcpy(&word, &FRAMEBUFFER[i], sizeof(word));
+    hash = hash_word(hash, word);
+  }
+  return hash;
+}
+
+static uint32_t run_replay(const uint8_t *data, size_t len, int repeats,
+                           int render, int index) {
+  static game_t game;
+  replay_player_t player;
+  if (!replay_open(&player, data, len)) {
+    fprintf(stderr, "replay %d: bad header\n", index);
+    return 0;
+  }
+
+  uint8_t pads[PLAYER_COUNT];
+  uint64_t ticks = 0;
+  uint32_t frame_hash = HASH_SEED;
+  double start = now_seconds();
+  for (int r = 0; r < repeats; r++) {
+    // Every match starts from a fresh game, as the cart's first one does.
+    memset(&game, 0, sizeof(game));
+    replay_open(&player, data, len);
+    replay_start_match(&player, &game);
+    frame_hash = HASH_SEED;
+    while (replay_next(&player, pads)) {
+      game_update(&game, pads);
+      if (render) {
+        frame_hash = render_frame(&game, frame_hash);
+      }
+      ticks++;
+    }
+  }
+  double elapsed = now_seconds() - start;
+
+  printf("replay %d: %d players, %llu ticks", index, player.players,
+         (unsigned long long)(ticks / repeats));
+  printf(", score");
+  for (int i = 0; i < player.players; i++) {
+    printf(" %d", game.score[i]);
+  }
+  printf(", hash %08x", hash_game(&game));
+  if (render) {
+    printf(", frames %08x", frame_hash);
+  }
+  if (elapsed > 0) {
+    printf(", %.0f %s/s", ticks / elapsed, render ? "frames" : "ticks");
+  }
+  printf("\n");
+  return 1;
+}
+
+int main(int argc, char **argv) {
+  int repeats = 1;
+  int render = 0;
+  int threads = 1;
+  const char *path = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      repeats = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-r") == 0) {
+      render = 1;
+    } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+    } else {
+      path = argv[i];
+    }
+  }
+  if (path == NULL || repeats < 1) {
+    fprintf(stderr, "usage: %s [-n repeats] [-r] [-t threads] console.log\n",
+            argv[0]);
+    return 2;
+  }
+
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    perror(path);
+    return 1;
+  }
+
+  if (render && threads != 1) {
+    pool = pool_create(threads);
+    set_band_runner(pool_band_runner);
+  }
+
+  static logged_replay_t replay;
+  char line[LINE_LEN];
+  int in_replay = 0;
+  int failed = 0;
+  while (fgets(line, sizeof(line), file) != NULL) {
+    // Console lines may carry a prefix, so look for the marker anywhere.
+    const char *marker = strstr(line, "replay ");
+    if (marker == NULL) {
+      continue;
+    }
+    const char *payload = marker + strlen("replay ");
+    if (strncmp(payload, "begin", 5) == 0) {
+      in_replay = 1;
+      replay.len = 0;
+    } else if (strncmp(payload, "end", 3) == 0) {
+      if (in_replay && !keep_replay(&replay)) {
+        fprintf(stderr, "out of memory\n");
+        failed = 1;
+      }
+      in_replay = 0;
+    } else if (in_replay && !parse_hex(payload, replay.data, &replay.len)) {
+      fprintf(stderr, "replay %d: malformed line\n", replay_count);
+      in_replay = 0;
+      failed = 1;
+    }
+  }
+  fclose(file);
+
+  for (int i = 0; i < replay_count; i++) {
+    failed |= !run_replay(replays[i].data, replays[i].len, repeats, render, i);
+  }
+  free(replays);
+  if (pool != NULL) {
+    pool_destroy(pool);
+  }
+
+  if (replay_count == 0) {
+    fprintf(stderr, "%s: no replays found\n", path);
+    return 1;
+  }
+  return failed;
+}
@@ -0,0 +1,76 @@
+// Native stand-in for the WASM-4 runtime, used by the headless host tools.
+// Memory-mapped registers live in a plain array. The line and rectangle
+// imports the 3D view is drawn with write the framebuffer like the real
+// runtime; the others only produce pixels nobody checks, or sound, and do
+// nothing.
+
+#include "wasm4.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+uint8_t wasm4_memory[0x19a0];
+
+void blit(const uint8_t *data, int32_t x, int32_t y, uint32_t width,
+          uint32_t height, uint32_t flags) {}
+
+void blitSub(const uint8_t *data, int32_t x, int32_t y, uint32_t width,
+             uint32_t height, uint32_t src_x, uint32_t src_y, uint32_t stride,
+             uint32_t flags) {}
+
+void line(int32_t x1, int32_t y1, int32_t x2, int32_t y2) {}
+
+// Sets a pixel to draw color index color, 1 to 4; 0 is transparent.
+static void plot(int32_t x, int32_t y, uint16_t color) {
+  if (color == 0 || x < 0 || y < 0 || x >= SCREEN_SIZE || y >= SCREEN_SIZE) {
+    return;
+  }
+  uint8_t *byte = &FRAMEBUFFER[y * (SCREEN_SIZE / 4) + x / 4];
+  int shift = (x % 4) * 2;
+  *byte = (uint8_t)((*byte & ~(3 << shift)) | ((color - 1) & 3) << shift);
+}
+
+void hline(int32_t x, int32_t y, uint32_t len) {
+  for (uint32_t i = 0; i < len; i++) {
+    plot(x + (int32_t)i, y, *DRAW_COLORS & 0xf);
+  }
+}
+
+void vline(int32_t x, int32_t y, uint32_t len) {
+  for (uint32_t i = 0; i < len; i++) {
+    plot(x, y + (int32_t)i, *DRAW_COLORS & 0xf);
+  }
+}
+
+void oval(int32_t x, int32_t y, uint32_t width, uint32_t height) {}
+
+// Filled in draw color 1 with an outline in draw color 2, if set.
+void rect(int32_t x, int32_t y, uint32_t width, uint32_t height) {
+  uint16_t fill = *DRAW_COLORS & 0xf;
+  uint16_t outline = (*DRAW_COLORS >> 4) & 0xf;
+  for (uint32_t j = 0; j < height; j++) {
+    for (uint32_t i = 0; i < width; i++) {
+      int edge = i == 0 || j == 0 || i == width - 1 || j == height - 1;
+      plot(x + (int32_t)i, y + (int32_t)j, edge && outline ? outline : fill);
+    }
+  }
+}
+
+void text(const char *text, int32_t x, int32_t y) {}
+
+void tone(uint32_t frequency, uint32_t duration, uint32_t volume,
+          uint32_t flags) {}
+
+uint32_t diskr(void *dest, uint32_t size) { return 0; }
+
+uint32_t diskw(const void *src, uint32_t size) { return 0; }
+
+void trace(const char *str) { puts(str); }
+
+void tracef(const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  vprintf(fmt, args);
+  va_end(args);
+  putchar('\n');
+}
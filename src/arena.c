@@ -0,0 +1,49 @@
+#include "arena.h"
+
+static uint8_t frame_memory[FRAME_ARENA_SIZE]
+    __attribute__((aligned(ARENA_ALIGN)));
+
+arena_t frame_arena = {
+    .base = frame_memory, .size = FRAME_ARENA_SIZE, .used = 0, .high_water = 0,
+    .failures = 0};
+
+static size_t align_up(size_t size) { return ARENA_ROUND(size); }
+
+static void update_high_water(arena_t *arena) {
+  if (arena->used > arena->high_water) {
+    arena->high_water = arena->used;
+  }
+}
+
+void arena_reset(arena_t *arena) { arena->used = 0; }
+
+void *arena_alloc(arena_t *arena, size_t size) {
+  size = align_up(size);
+  if (size > arena->size - arena->used) {
+    arena->failures++;
+    return NULL;
+  }
+  void *ret = arena->base + arena->used;
+  arena->used += size;
+  update_high_water(arena);
+  return ret;
+}
+
+void *arena_alloc_rest(arena_t *arena, size_t elem_size, size_t max_count,
+                       size_t *count) {
+  size_t available = (arena->size - arena->used) / elem_size;
+  *count = available < max_count ? available : max_count;
+  void *ret = arena->base + arena->used;
+  // Not counted towards the high water mark until trimmed to its real size.
+  arena->used += align_up(*count * elem_size);
+  return ret;
+}
+
+void arena_trim(arena_t *arena, void *ptr, size_t size) {
+  arena->used = (size_t)((uint8_t *)ptr - arena->base) + align_up(size);
+  update_high_water(arena);
+}
+
+size_t arena_mark(arena_t *arena) { return arena->used; }
+
+void arena_release(arena_t *arena, size_t mark) { arena->used = mark; }
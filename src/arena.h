@@ -0,0 +1,51 @@
+#ifndef ARENA_H_INCLUDED
+#define ARENA_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-frame scratch: polygon lists, vertex buffers and other render
+// temporaries. main.c works out the most its frames use, a full polygon list
+// among it, and checks at compile time that it fits. Native builds have
+// 8-byte pointers and sizes, and their band runner bins polygons too.
+#ifdef WASM4_HOST
+#define FRAME_ARENA_SIZE (28 * 1024)
+#else
+#define FRAME_ARENA_SIZE (19 * 1024)
+#endif
+#define ARENA_ALIGN 8
+// Bytes an allocation of size takes from an arena.
+#define ARENA_ROUND(size) (((size) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+// Bump-pointer allocator. Nothing is freed individually; the whole arena is
+// reset at the top of every frame.
+typedef struct {
+  uint8_t *base;
+  size_t size;
+  size_t used;
+  size_t high_water; // Largest `used` seen since startup
+  size_t failures;   // Allocations refused since startup
+} arena_t;
+
+extern arena_t frame_arena;
+
+void arena_reset(arena_t *arena);
+
+// Returns NULL when the arena is exhausted, and counts the failure. Callers
+// must not go on with the frame's work as if it had succeeded.
+void *arena_alloc(arena_t *arena, size_t size);
+
+// Claims the rest of the arena, up to max_count elements, for a list whose
+// final length is not known yet. Call arena_trim() once it is filled.
+void *arena_alloc_rest(arena_t *arena, size_t elem_size, size_t max_count,
+                       size_t *count);
+
+// Shrinks the most recent allocation to size bytes.
+void arena_trim(arena_t *arena, void *ptr, size_t size);
+
+// Scoped temporaries: everything allocated after arena_mark() is released
+// by arena_release().
+size_t arena_mark(arena_t *arena);
+void arena_release(arena_t *arena, size_t mark);
+
+#endif
@@ -1,16 +1,319 @@
 #include "draw.h"
 #include "wasm4.h"
 
+#include <string.h>
+
+static uint8_t *target = FRAMEBUFFER;
+static int target_stride = SCREEN_SIZE / 4;
+
+void set_target(uint8_t *pixels, int stride) {
+  target = pixels;
+  target_stride = stride;
+}
+
+uint8_t *target_row(int y) { return &target[y * target_stride]; }
+
 void pixel(uint8_t x, uint8_t y, uint8_t color) {
-  uint16_t byte_idx = y * 40 + (x / 4);
+  uint8_t *byte = &target_row(y)[x / 4];
   uint8_t bit_offset = (x % 4) * 2;
-  FRAMEBUFFER[byte_idx] &= ~(0x3 << bit_offset);        // Clear existing bits
-  FRAMEBUFFER[byte_idx] |= (color & 0x3) << bit_offset; // Set new color
+  *byte &= ~(0x3 << bit_offset);        // Clear existing bits
+  *byte |= (color & 0x3) << bit_offset; // Set new color
+}
+
+void blit_doubled(const uint8_t *pixels, int w, int h, int x, int y) {
+  uint8_t *dest = &FRAMEBUFFER[y * (SCREEN_SIZE / 4) + x / 4];
+  for (int row = 0; row < h; row++) {
+    for (int i = 0; i < w / 4; i += 2) {
+      // Eight pixels spread from 2 to 4 bits each, then each repeated.
+      uint32_t p = pixels[i] | pixels[i + 1] << 8;
+      p = (p | p << 8) & 0x00ff00ffu;
+      p = (p | p << 4) & 0x0f0f0f0fu;
+      p = (p | p << 2) & 0x33333333u;
+      p |= p << 2;
+      dest[2 * i] = (uint8_t)p;
+      dest[2 * i + 1] = (uint8_t)(p >> 8);
+      dest[2 * i + 2] = (uint8_t)(p >> 16);
+      dest[2 * i + 3] = (uint8_t)(p >> 24);
+    }
+    memcpy(dest + SCREEN_SIZE / 4, dest, w / 2);
+    pixels += w / 4;
+    dest += SCREEN_SIZE / 2;
+  }
+}
+
+// The cart has one thread; native builds may draw bands concurrently.
+#ifdef WASM4_HOST
+#define DRAW_STATE static _Thread_local
+#else
+#define DRAW_STATE static
+#endif
+
+DRAW_STATE viewport_t clip = {0, 0, SCREEN_SIZE, SCREEN_SIZE};
+
+void set_clip(const viewport_t *viewport) { clip = *viewport; }
+
+viewport_t get_clip(void) { return clip; }
+
+static int is_inside_clip(int x, int y) {
+  return x >= clip.x && x < clip.x + clip.w && y >= clip.y &&
+         y < clip.y + clip.h;
+}
+
+DRAW_STATE coverage_row_t *coverage = NULL;
+
+void set_coverage(coverage_row_t *rows) { coverage = rows; }
+
+DRAW_STATE uint8_t fill[2] = {0xaa, 0xaa};
+
+void set_fill(uint8_t even_rows, uint8_t odd_rows) {
+  fill[0] = even_rows;
+  fill[1] = odd_rows;
+}
+
+// Writes the fill pattern to x0..x1 of row y.
+static void put_span(int x0, int x1, int y) {
+  uint8_t pattern = fill[y & 1];
+  uint8_t *row = target_row(y);
+  int b0 = x0 / 4;
+  int b1 = x1 / 4;
+  uint8_t first = (uint8_t)(0xff << (x0 % 4 * 2));
+  uint8_t last = (uint8_t)(0xff >> ((3 - x1 % 4) * 2));
+  if (b0 == b1) {
+    first &= last;
+    row[b0] = (uint8_t)((row[b0] & ~first) | (pattern & first));
+    return;
+  }
+  row[b0] = (uint8_t)((row[b0] & ~first) | (pattern & first));
+  memset(&row[b0 + 1], pattern, b1 - b0 - 1);
+  row[b1] = (uint8_t)((row[b1] & ~last) | (pattern & last));
+}
+
+// Marks x0..x1 of a row drawn.
+static void cover(coverage_row_t *row, int x0, int x1) {
+  for (int w = x0 / 32; w <= x1 / 32; w++) {
+    uint32_t mask = ~0u;
+    if (w == x0 / 32) {
+      mask &= ~0u << (x0 % 32);
+    }
+    if (w == x1 / 32) {
+      mask &= ~0u >> (31 - x1 % 32);
+    }
+    row->words[w] |= mask;
+  }
 }
 
-void bline(int x0, int y0, int x1, int y1);
+// The first x from x up to end whose coverage bit is drawn (1) or not (0),
+// or end + 1 if there is none.
+static int find_coverage(const coverage_row_t *row, int x, int end,
+                         int drawn) {
+  while (x <= end) {
+    uint32_t word = row->words[x / 32];
+    word = (drawn ? word : ~word) >> (x % 32);
+    if (word != 0) {
+      x += __builtin_ctz(word);
+      return x <= end ? x : end + 1;
+    }
+    x = (x / 32 + 1) * 32;
+  }
+  return end + 1;
+}
+
+// Fills x0..x1 of row y, both inside the clip rectangle, with the fill.
+// With coverage, only the parts no earlier polygon drew are written.
+static void fill_span(int x0, int x1, int y) {
+  if (coverage == NULL) {
+    put_span(x0, x1, y);
+    return;
+  }
+  coverage_row_t *row = &coverage[y - clip.y];
+  int x = find_coverage(row, x0, x1, 0);
+  while (x <= x1) {
+    int end = find_coverage(row, x, x1, 1) - 1;
+    put_span(x, end, y);
+    x = find_coverage(row, end + 1, x1, 0);
+  }
+  cover(row, x0, x1);
+}
+
+// Plots a pixel in the outline color if it's inside the clip rectangle and,
+// with coverage, not drawn yet.
+static void plot(int x, int y) {
+  if (!is_inside_clip(x, y)) {
+    return;
+  }
+  if (coverage != NULL) {
+    uint32_t *word = &coverage[y - clip.y].words[x / 32];
+    uint32_t bit = 1u << (x % 32);
+    if (*word & bit) {
+      return;
+    }
+    *word |= bit;
+  }
+  pixel(x, y, *DRAW_COLORS);
+}
+
+// Triangles whose bounding box fits in SMALL_TRI x SMALL_TRI pixels, most of
+// them at this resolution, are rasterized as a block: a bit per pixel for
+// the outline, traced like bline(), and for the fill, from integer edge
+// functions, then written a row of 2bpp bytes at a time.
+#define SMALL_TRI 8
+
+// bline() into a block of bit rows, the leftmost pixel in bit 0.
+static void mask_line(uint8_t *mask, int x0, int y0, int x1, int y1) {
+  int steep = abs(x0 - x1) < abs(y0 - y1);
+  if (steep) {
+    int tmp = x0;
+    x0 = y0;
+    y0 = tmp;
+    tmp = x1;
+    x1 = y1;
+    y1 = tmp;
+  }
+  if (x0 > x1) {
+    int tmp = x0;
+    x0 = x1;
+    x1 = tmp;
+    tmp = y0;
+    y0 = y1;
+    y1 = tmp;
+  }
+  int dx = x1 - x0;
+  int dy = abs(y1 - y0);
+  int error = dx / 2;
+  int ystep = y0 < y1 ? 1 : -1;
+  int y = y0;
+  for (int x = x0; x <= x1; x++) {
+    if (steep) {
+      mask[x] |= 1 << y;
+    } else {
+      mask[y] |= 1 << x;
+    }
+    error -= dy;
+    if (error < 0) {
+      y += ystep;
+      error += dx;
+    }
+  }
+}
+
+// Draws a small triangle, clipped. One with no area is a single pixel if its
+// corners meet and dropped otherwise: it is edge-on, and the triangles next
+// to it draw the edge. The whole box is rasterized and then clipped, so a
+// triangle crossing the clip draws the same pixels on either side of it.
+static void small_tri(int x0, int y0, int x1, int y1, int x2, int y2, int left,
+                      int top, int width, int height) {
+  uint8_t outline[SMALL_TRI] = {0};
+  uint8_t inside[SMALL_TRI] = {0};
+  int area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+  if (area == 0) {
+    if (width > 1 || height > 1) {
+      return;
+    }
+    outline[0] = 1;
+  } else {
+    x0 -= left;
+    x1 -= left;
+    x2 -= left;
+    y0 -= top;
+    y1 -= top;
+    y2 -= top;
+    mask_line(outline, x0, y0, x1, y1);
+    mask_line(outline, x1, y1, x2, y2);
+    mask_line(outline, x2, y2, x0, y0);
+    // Edge functions of pixel (0, 0), positive inside, and their steps.
+    int sign = area > 0 ? 1 : -1;
+    int e[3] = {sign * (x0 * y1 - y0 * x1), sign * (x1 * y2 - y1 * x2),
+                sign * (x2 * y0 - y2 * x0)};
+    int step_x[3] = {sign * (y0 - y1), sign * (y1 - y2), sign * (y2 - y0)};
+    int step_y[3] = {sign * (x1 - x0), sign * (x2 - x1), sign * (x0 - x2)};
+    for (int y = 0; y < height; y++) {
+      int w0 = e[0] + y * step_y[0];
+      int w1 = e[1] + y * step_y[1];
+      int w2 = e[2] + y * step_y[2];
+      for (int x = 0; x < width; x++) {
+        if ((w0 | w1 | w2) >= 0) {
+          inside[y] |= 1 << x;
+        }
+        w0 += step_x[0];
+        w1 += step_x[1];
+        w2 += step_x[2];
+      }
+    }
+  }
+
+  // Only the rows and columns of the box inside the clip rectangle are
+  // written; left and width narrow to those columns, so nothing past the
+  // clip is touched, coverage words included.
+  int skip = clip.x > left ? clip.x - left : 0;
+  int columns = clip.x + clip.w - left < width ? clip.x + clip.w - left
+                                               : width;
+  uint32_t visible = columns > skip ? ((1u << columns) - 1) >> skip : 0;
+  int first_row = clip.y > top ? clip.y - top : 0;
+  int end_row = clip.y + clip.h - top < height ? clip.y + clip.h - top
+                                               : height;
+  left += skip;
+  width = columns > skip ? columns - skip : 0;
+
+  // The outline color as pixel() draws it, in every pixel of a word.
+  uint32_t outline_color = (*DRAW_COLORS & 0x3) * 0x55555555u;
+  int shift = (left % 4) * 2;
+  for (int y = first_row; y < end_row; y++) {
+    outline[y] >>= skip;
+    uint32_t drawn = (outline[y] | inside[y] >> skip) & visible;
+    if (coverage != NULL) {
+      // Skip what is drawn already and record the rest. A block that
+      // crosses into the next word has pixels there, so that word exists.
+      uint32_t *words = &coverage[top + y - clip.y].words[left / 32];
+      int bit = left % 32;
+      uint64_t pair = words[0];
+      if (bit + width > 32) {
+        pair |= (uint64_t)words[1] << 32;
+      }
+      drawn &= ~(uint32_t)(pair >> bit);
+      pair = (uint64_t)drawn << bit;
+      words[0] |= (uint32_t)pair;
+      if (bit + width > 32) {
+        words[1] |= (uint32_t)(pair >> 32);
+      }
+    }
+    if (drawn == 0) {
+      continue;
+    }
+    // Up to SMALL_TRI + 3 pixels, three bytes, the first aligned.
+    uint32_t mask = 0;
+    uint32_t edge = 0;
+    for (int x = 0; x < width; x++) {
+      if (drawn >> x & 1) {
+        mask |= 3u << (x * 2);
+        edge |= (outline[y] >> x & 1) * (3u << (x * 2));
+      }
+    }
+    mask <<= shift;
+    edge <<= shift;
+    uint32_t value = (outline_color & edge) |
+                     (fill[(top + y) & 1] * 0x01010101u & mask & ~edge);
+    uint8_t *dest = &target_row(top + y)[left / 4];
+    for (; mask != 0; mask >>= 8, value >>= 8, dest++) {
+      *dest = (uint8_t)((*dest & ~mask) | (value & mask));
+    }
+  }
+}
 
 void tri(int x0, int y0, int x1, int y1, int x2, int y2) {
+  int left = x0 < x1 ? (x0 < x2 ? x0 : x2) : (x1 < x2 ? x1 : x2);
+  int right = x0 > x1 ? (x0 > x2 ? x0 : x2) : (x1 > x2 ? x1 : x2);
+  int top = y0 < y1 ? (y0 < y2 ? y0 : y2) : (y1 < y2 ? y1 : y2);
+  int bottom = y0 > y1 ? (y0 > y2 ? y0 : y2) : (y1 > y2 ? y1 : y2);
+  if (right < clip.x || left >= clip.x + clip.w || bottom < clip.y ||
+      top >= clip.y + clip.h) {
+    return;
+  }
+  if (right - left < SMALL_TRI && bottom - top < SMALL_TRI) {
+    small_tri(x0, y0, x1, y1, x2, y2, left, top, right - left + 1,
+              bottom - top + 1);
+    return;
+  }
+
   // Sort the vertices by y-coordinate ascending (y0 <= y1 <= y2)
   if (y0 > y1) {
     int tmp;
@@ -40,10 +343,22 @@ void tri(int x0, int y0, int x1, int y1, int x2, int y2) {
     x1 = tmp;
   }
 
+  // Front to back, the outline goes first so the fill doesn't cover it.
+  if (coverage != NULL) {
+    bline(x0, y0, x1, y1);
+    bline(x1, y1, x2, y2);
+    bline(x2, y2, x0, y0);
+  }
+
   // Option 1: Draw the filled triangle first, then the outline separately
-  // Fill the triangle
+  // Fill the triangle, only the rows inside the clip rectangle
   int total_height = y2 - y0;
-  for (int i = 0; i < total_height; i++) {
+  int first_row = clip.y - y0 > 0 ? clip.y - y0 : 0;
+  int end_row = clip.y + clip.h - y0;
+  if (end_row > total_height) {
+    end_row = total_height;
+  }
+  for (int i = first_row; i < end_row; i++) {
     int yi = y0 + i;
     int second_half = i > y1 - y0 || y1 == y0;
     int segment_height = second_half ? y2 - y1 : y1 - y0;
@@ -60,18 +375,43 @@ void tri(int x0, int y0, int x1, int y1, int x2, int y2) {
     }
 
     // Draw horizontal line for filling
-    if (yi >= 0 && yi < SCREEN_SIZE) {
-      hline(ax, yi, bx - ax + 1); // +1 to include the endpoint
+    if (ax < clip.x) {
+      ax = clip.x;
+    }
+    if (bx >= clip.x + clip.w) {
+      bx = clip.x + clip.w - 1;
+    }
+    if (ax <= bx) {
+      fill_span(ax, bx, yi);
     }
   }
 
   // Draw the outline separately using line algorithm
-  bline(x0, y0, x1, y1);
-  bline(x1, y1, x2, y2);
-  bline(x2, y2, x0, y0);
+  if (coverage == NULL) {
+    bline(x0, y0, x1, y1);
+    bline(x1, y1, x2, y2);
+    bline(x2, y2, x0, y0);
+  }
+}
+
+// Steps along the major axis a line of the given slope, starting with error,
+// takes before its minor coordinate has moved by moved or more.
+static long long steps_until(int moved, int dx, int dy, int error) {
+  if (moved <= 0) {
+    return 0;
+  }
+  if (dy == 0) {
+    return (long long)dx + 1;
+  }
+  // After k steps it has moved m times, the least m keeping
+  // error - k * dy + m * dx non-negative.
+  return ((long long)(moved - 1) * dx + error) / dy + 1;
 }
 
-// Bresenham's line algorithm for the outline
+// Bresenham's line algorithm for the outline. Only the steps whose pixels
+// fall in the clip rectangle are traced, starting from the error the whole
+// line would have reached there, so it plots the same pixels as tracing it
+// all.
 void bline(int x0, int y0, int x1, int y1) {
   int steep = 0;
   if (abs(x0 - x1) < abs(y0 - y1)) {
@@ -101,17 +441,42 @@ void bline(int x0, int y0, int x1, int y1) {
   int dy = abs(y1 - y0);
   int error = dx / 2;
   int ystep = (y0 < y1) ? 1 : -1;
-  int y = y0;
 
-  for (int x = x0; x <= x1; x++) {
+  // The clip rectangle along the major and minor axes.
+  int major0 = steep ? clip.y : clip.x;
+  int major1 = major0 + (steep ? clip.h : clip.w) - 1;
+  int minor0 = steep ? clip.x : clip.y;
+  int minor1 = minor0 + (steep ? clip.w : clip.h) - 1;
+  // Steps before the minor coordinate enters the clip and before it leaves.
+  int enter = ystep > 0 ? minor0 - y0 : y0 - minor1;
+  int leave = ystep > 0 ? minor1 - y0 + 1 : y0 - minor0 + 1;
+  long long first = steps_until(enter, dx, dy, error);
+  long long last = steps_until(leave, dx, dy, error) - 1;
+  if (first < major0 - x0) {
+    first = major0 - x0;
+  }
+  if (last > major1 - x0) {
+    last = major1 - x0;
+  }
+  if (last > dx) {
+    last = dx;
+  }
+  if (first > last) {
+    return;
+  }
+
+  // Where the line is after the first steps.
+  long long moved = first * dy <= error
+                        ? 0
+                        : (first * dy - error + dx - 1) / dx;
+  error = (int)(error - first * dy + moved * dx);
+  int y = y0 + ystep * (int)moved;
+
+  for (int x = x0 + (int)first; x <= x0 + last; x++) {
     if (steep) {
-      if (y >= 0 && y < SCREEN_SIZE && x >= 0 && x < SCREEN_SIZE) {
-        pixel(y, x, *DRAW_COLORS);
-      }
+      plot(y, x);
     } else {
-      if (x >= 0 && x < SCREEN_SIZE && y >= 0 && y < SCREEN_SIZE) {
-        pixel(x, y, *DRAW_COLORS);
-      }
+      plot(x, y);
     }
 
     error -= dy;
@@ -122,8 +487,53 @@ void bline(int x0, int y0, int x1, int y1) {
   }
 }
 
+void sprite(const uint8_t *rows, int height, int x, int y) {
+  for (int row = 0; row < height; row++) {
+    for (int col = 0; col < 8; col++) {
+      if (rows[row] & (0x80 >> col)) {
+        plot(x + col, y + row);
+      }
+    }
+  }
+}
+
+void diamond(int x, int y, int radius) {
+  for (int dy = -radius; dy <= radius; dy++) {
+    int yi = y + dy;
+    if (yi < clip.y || yi >= clip.y + clip.h) {
+      continue;
+    }
+    int half = radius - abs(dy);
+    // The edge pixels of each row form the outline.
+    if (coverage != NULL) {
+      plot(x - half, yi);
+      plot(x + half, yi);
+    }
+    int ax = x - half;
+    int bx = x + half;
+    if (ax < clip.x) {
+      ax = clip.x;
+    }
+    if (bx >= clip.x + clip.w) {
+      bx = clip.x + clip.w - 1;
+    }
+    if (ax <= bx) {
+      fill_span(ax, bx, yi);
+    }
+    if (coverage == NULL) {
+      plot(x - half, yi);
+      plot(x + half, yi);
+    }
+  }
+}
+
 int is_point_visible(const vec2i_t *p) {
-  return p->x >= 0 && p->x < SCREEN_SIZE && p->y >= 0 && p->y < SCREEN_SIZE;
+  return is_inside_clip(p->x, p->y);
+}
+
+int is_rect_visible(const viewport_t *rect) {
+  return rect->x < clip.x + clip.w && rect->x + rect->w > clip.x &&
+         rect->y < clip.y + clip.h && rect->y + rect->h > clip.y;
 }
 
 int is_triangle_visible(const vec2i_t *r0, const vec2i_t *r1,
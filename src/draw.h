@@ -1,6 +1,7 @@
 #ifndef DRAW_H_INCLUDED
 #define DRAW_H_INCLUDED
 
+#include <stdint.h>
 #include <stdlib.h>
 
 typedef struct {
@@ -11,10 +12,54 @@ typedef struct {
     int x, y;
   } vec2i_t;
 
+// A rectangle of the screen that the 3D view is drawn into.
+typedef struct {
+  int x, y, w, h;
+} viewport_t;
+
+// Per-row coverage for drawing front to back: a bit per pixel of the screen
+// row, set once it is drawn, pixel x in bit x % 32 of word x / 32. All zero
+// is a row with nothing drawn.
+#define COVERAGE_WORDS 5 // SCREEN_SIZE / 32
+typedef struct {
+  uint32_t words[COVERAGE_WORDS];
+} coverage_row_t;
+
 void pixel(uint8_t x, uint8_t y, uint8_t color);
+// Where the drawing functions below draw: a packed 2bpp image of stride
+// bytes a row, FRAMEBUFFER by default. Unlike the clip, the target is shared
+// by all threads.
+void set_target(uint8_t *pixels, int stride);
+// Start of row y of the target.
+uint8_t *target_row(int y);
+// Copies a packed 2bpp image of w x h pixels, w a multiple of 8, into the
+// framebuffer at twice the size, its top left corner at x, y with x a
+// multiple of 4.
+void blit_doubled(const uint8_t *pixels, int w, int h, int x, int y);
+// Restricts tri() and the visibility tests to a viewport (whole screen by
+// default).
+void set_clip(const viewport_t *viewport);
+viewport_t get_clip(void);
+// Makes the drawing functions below skip pixels that rows, one per row of
+// the clip rectangle, mark as drawn, and record what they draw. NULL turns
+// coverage off. Clip and coverage are per thread in native builds, so
+// threads can draw disjoint parts of the screen at once.
+void set_coverage(coverage_row_t *rows);
+// Fill of tri() and diamond(): framebuffer bytes, four 2bpp pixels, for
+// even and odd rows, so fills can be dithered. Solid framebuffer value 2
+// (draw color 3) by default; outlines stay in the first draw color.
+void set_fill(uint8_t even_rows, uint8_t odd_rows);
 void tri(int x0, int y0, int x1, int y1, int x2, int y2);
+// Clipped line in the outline color; a single pixel when both ends meet.
+void bline(int x0, int y0, int x1, int y1);
+// Clipped 1bpp sprite up to 8 pixels wide, one byte per row with the
+// leftmost pixel in the top bit, set bits drawn in the outline color.
+void sprite(const uint8_t *rows, int height, int x, int y);
+// Clipped diamond of the given radius: filled, with outlined tips.
+void diamond(int x, int y, int radius);
 
 int is_point_visible(const vec2i_t *p);
+int is_rect_visible(const viewport_t *rect);
 int is_triangle_visible(const vec2i_t *r0, const vec2i_t *r1,
     const vec2i_t *r2);
 
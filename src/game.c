@@ -0,0 +1,222 @@
+#include "game.h"
+#include "wasm4.h"
+
+#include "menu.h"
+#include "models.h"
+#include <math.h>
+#include <string.h>
+
+// The simulation must run bit for bit the same in the cart and the native
+// tools, whose libcs round sinf() and cosf() differently, so it has its own:
+// a Taylor polynomial on the angle folded into [-pi / 2, pi / 2], within a
+// few 1e-6 of sinf() for the angles the game reaches. Built with
+// -ffp-contract=off, every step rounds the same everywhere.
+static float game_sinf(float x) {
+  x -= floorf(x * (float)(0.5 / M_PI) + 0.5f) * (float)(2 * M_PI);
+  if (x > (float)(M_PI / 2)) {
+    x = (float)M_PI - x;
+  } else if (x < (float)(-M_PI / 2)) {
+    x = (float)-M_PI - x;
+  }
+  float x2 = x * x;
+  float p = -1.f / 39916800;
+  p = p * x2 + 1.f / 362880;
+  p = p * x2 - 1.f / 5040;
+  p = p * x2 + 1.f / 120;
+  p = p * x2 - 1.f / 6;
+  return x + x * x2 * p;
+}
+
+static float game_cosf(float x) { return game_sinf(x + (float)(M_PI / 2)); }
+
+void transformation_debug(game_t *game, object_t *obj,
+                          size_t obj_idx __attribute__((unused)), float time) {
+  obj->pos.x = game_cosf(time * M_PI) * 30;
+  obj->rot_y = 2.f * M_PI * time / 2.0f;
+  obj->scale = 0.5f + 0.5f * game_sinf(2 * time * M_PI);
+  obj->changed_tick = game->tick;
+}
+
+void init_game(game_t *game) {
+  game->object_count = 0;
+  particles_clear(&game->particles);
+  // Generate seed based on current tick
+  game->mountain_seed = game->tick * 1234567891u;
+  for (int i = 0; i < PLAYER_COUNT; i++) {
+    game->score[i] = 0;
+    game->shot_time[i] = -SHOT_DELAY;
+  }
+
+  // Spawn tanks based on selected player count
+  float positions[][2] = {{100, 100}, {-100, 100}, {100, -100}, {-100, -100}};
+  float rotations[] = {0.75f * M_PI, 0.25f * M_PI, -0.75f * M_PI,
+                       -0.25f * M_PI};
+
+  for (int i = 0; i < game->selected_players; i++) {
+    spawn_object(&tank_model, positions[i][0], 0, positions[i][1], rotations[i],
+                 TANK_SCALE, 0.f, NULL, game->objects, &game->object_count,
+                 OBJECTS_LEN);
+  }
+
+  spawn_object(&cube_model, 0, 0, 0, 0, 1.f, 0.f, transformation_debug,
+               game->objects, &game->object_count, OBJECTS_LEN);
+  for (size_t i = 0; i < game->object_count; i++) {
+    game->objects[i].changed_tick = game->tick;
+  }
+
+  for (int i = 0; i < game->selected_players; i++) {
+    game->cameras[i].pos = game->objects[i].pos;
+    game->cameras[i].pos.y = CAMERA_OFFSET;
+    game->cameras[i].yaw = -game->objects[i].rot_y;
+    game->cameras[i].pitch = 0.f;
+    game->cameras[i].movement_speed = 0.5f;
+    game->cameras[i].rotation_speed = 0.05f;
+    game->cameras[i].changed_tick = game->tick;
+  }
+}
+
+void update_projectile(game_t *game, object_t *obj, size_t obj_idx,
+                       float time) {
+  float cos_yaw = game_cosf(-obj->rot_y);
+  float sin_yaw = game_sinf(-obj->rot_y);
+  float speed = 2.f;
+  vec3f_t forward = {cos_yaw, 0, sin_yaw};
+  obj->pos.x += forward.x * speed;
+  obj->pos.z += forward.z * speed;
+  obj->changed_tick = game->tick;
+
+  if (time - obj->spawn_time > 3.f) {
+    remove_object(game->objects, obj_idx, &game->object_count);
+  } else {
+    for (int i = 0; i < game->selected_players; i++) {
+      uint8_t owner = obj->tag;
+      if (owner == i) {
+        continue; // Not colliding with the player who shot.
+      } else {
+        object_t *tank = &game->objects[i];
+        float distance = vec3f_xz_distance(obj->pos, tank->pos);
+        if (distance < TANK_COLLISION_RADIUS) {
+          vec3f_t blast = {obj->pos.x, 8.f * TANK_SCALE, obj->pos.z};
+          particles_explode(&game->particles, &blast);
+          remove_object(game->objects, obj_idx, &game->object_count);
+          game->score[owner]++;
+          tone(300 | (110 << 16), 30, 40, 3);
+
+          // Check win condition
+          if (game->score[owner] >= WIN_SCORE) {
+            game->winner = owner;
+            game->state = GAME_STATE_WIN;
+            game->win_timer = 0;
+          }
+          break;
+        }
+      }
+    }
+  }
+}
+
+int handle_camera_movement(uint8_t gamepad, camera_t *camera) {
+  // Calculate forward and right vectors based on camera orientation
+  float cos_yaw = game_cosf(camera->yaw);
+  float sin_yaw = game_sinf(camera->yaw);
+
+  vec3f_t forward = {cos_yaw, 0, sin_yaw};
+
+  // Move forward/backward (UP/DOWN)
+  if (gamepad & BUTTON_UP) {
+    camera->pos.x += forward.x * camera->movement_speed;
+    camera->pos.y += forward.y * camera->movement_speed;
+    camera->pos.z += forward.z * camera->movement_speed;
+  }
+  if (gamepad & BUTTON_DOWN) {
+    camera->pos.x -= forward.x * camera->movement_speed;
+    camera->pos.y -= forward.y * camera->movement_speed;
+    camera->pos.z -= forward.z * camera->movement_speed;
+  }
+
+  float rotation_speed = camera->rotation_speed;
+  if (gamepad & BUTTON_1) {
+    rotation_speed /= 2.f;
+  }
+  if (gamepad & BUTTON_LEFT) {
+    camera->yaw += rotation_speed;
+  }
+  if (gamepad & BUTTON_RIGHT) {
+    camera->yaw -= rotation_speed;
+  }
+  return (gamepad &
+          (BUTTON_UP | BUTTON_DOWN | BUTTON_LEFT | BUTTON_RIGHT)) != 0;
+}
+
+void update_game(game_t *game, const uint8_t pads[PLAYER_COUNT]) {
+  float time = game->tick / 60.f;
+
+  // Input and game logic.
+  for (int i = 0; i < game->selected_players; i++) {
+    const uint8_t pad = pads[i];
+    object_t *player_object = &game->objects[i];
+    if (handle_camera_movement(pad, &game->cameras[i])) {
+      game->cameras[i].changed_tick = game->tick;
+      player_object->changed_tick = game->tick;
+    }
+    player_object->pos = game->cameras[i].pos;
+    player_object->pos.y -= CAMERA_OFFSET;
+    player_object->rot_y = -game->cameras[i].yaw;
+    if (pad & BUTTON_2 && time - game->shot_time[i] > SHOT_DELAY) {
+      game->shot_time[i] = time;
+      object_t *obj = spawn_object(
+          &projectile_model, player_object->pos.x, player_object->pos.y,
+          player_object->pos.z, player_object->rot_y, TANK_SCALE, time,
+          update_projectile, game->objects, &game->object_count, OBJECTS_LEN);
+      tone(60 | (40 << 16), 10, 40, 0); // Low-frequency pulse wave
+      obj->tag = (uint8_t)i;
+      obj->changed_tick = game->tick;
+    }
+  }
+
+  particles_update(&game->particles);
+  size_t i = game->object_count;
+  while (i-- > 0) {
+    object_update(game, &game->objects[i], i, time);
+  }
+}
+
+void game_update(game_t *game, const uint8_t pads[PLAYER_COUNT]) {
+  switch (game->state) {
+  case GAME_STATE_MENU:
+    update_menu(game, pads[0]);
+    break;
+  case GAME_STATE_PLAYER_SELECT:
+    update_player_select(game, pads[0]);
+    break;
+  case GAME_STATE_HELP:
+    update_help(game, pads[0]);
+    break;
+  case GAME_STATE_PLAYING:
+    update_game(game, pads);
+    break;
+  case GAME_STATE_WIN:
+    update_win(game);
+    break;
+  }
+
+  game->tick++;
+}
+
+size_t game_state_size(void) { return sizeof(game_t); }
+
+size_t game_save(const game_t *game, void *dest, size_t len) {
+  if (len < sizeof(game_t)) {
+    return 0;
+  }
+  memcpy(dest, game, sizeof(game_t));
+  return sizeof(game_t);
+}
+
+int game_load(game_t *game, const void *src, size_t len) {
+  if (len != sizeof(game_t)) {
+    return 0;
+  }
+  memcpy(game, src, sizeof(game_t));
+  return 1;
+}
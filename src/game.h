@@ -0,0 +1,77 @@
+#ifndef GAME_H_INCLUDED
+#define GAME_H_INCLUDED
+
+#include "object.h"
+#include "particles.h"
+#include <stdint.h>
+
+#define OBJECTS_LEN 128
+#define PLAYER_COUNT 4
+#define CAMERA_OFFSET 15.f
+
+#define TANK_SCALE 2.f
+#define TANK_COLLISION_RADIUS (TANK_SCALE * 5.f)
+
+#define SHOT_DELAY 3.f
+
+typedef enum {
+  GAME_STATE_MENU,
+  GAME_STATE_PLAYER_SELECT,
+  GAME_STATE_HELP,
+  GAME_STATE_PLAYING,
+  GAME_STATE_WIN
+} game_state_t;
+
+// Everything update() carries from one tick to the next, in one contiguous
+// block so it can be snapshotted and restored as a unit. Render scratch is
+// rebuilt every frame and deliberately lives elsewhere. Fields are ordered
+// by size to keep padding out. Nothing in the simulation touches globals, so
+// any number of games can run side by side.
+typedef struct game_s {
+  object_t objects[OBJECTS_LEN];
+  camera_t cameras[PLAYER_COUNT];
+  particles_t particles; // Explosion effects; cosmetic, so not hashed.
+  float shot_time[PLAYER_COUNT];
+  size_t object_count;
+  uint32_t tick;
+  uint32_t mountain_seed;
+  uint32_t win_timer;
+  uint16_t score[PLAYER_COUNT];
+  uint8_t state; // game_state_t
+  uint8_t selected_players;
+  uint8_t menu_selection;
+  uint8_t prev_gamepad;
+  uint8_t split_screen; // One viewport per player on a shared screen.
+  int8_t winner;
+} game_t;
+
+void init_game(game_t *game);
+
+// Advances the game by one tick. This is the whole simulation side of
+// update(): it reads nothing but pads and the game state, and draws nothing,
+// so replays and headless runs can drive it directly.
+void game_update(game_t *game, const uint8_t pads[PLAYER_COUNT]);
+
+// Moves and turns a player's camera by its pad. Returns whether the camera
+// moved or turned.
+int handle_camera_movement(uint8_t gamepad, camera_t *camera);
+
+// Size of a serialized game state in bytes.
+size_t game_state_size(void);
+
+// Copies the game state to dest. Returns the number of bytes written, or 0
+// if len is too small. The snapshot holds model and update pointers, so it
+// can only be restored by the same cart build.
+size_t game_save(const game_t *game, void *dest, size_t len);
+
+// Restores a snapshot written by game_save(). Returns 0 if len does not
+// match the current state size, 1 otherwise.
+int game_load(game_t *game, const void *src, size_t len);
+
+#ifdef WASM4_HOST
+// Draws a match in progress into the framebuffer the way update() does, for
+// the native tools. Defined with the renderer in main.c.
+void host_draw_game(const game_t *game);
+#endif
+
+#endif
@@ -0,0 +1,65 @@
+#include "hash.h"
+#include "models.h"
+
+uint32_t hash_word(uint32_t hash, uint32_t word) {
+  return (((hash << 5) | (hash >> 27)) ^ word) * 0x9e3779b9u;
+}
+
+uint32_t hash_float(uint32_t hash, float value) {
+  union {
+    float f;
+    uint32_t u;
+  } bits = {.f = value};
+  return hash_word(hash, bits.u);
+}
+
+uint32_t hash_vec3f(uint32_t hash, const vec3f_t *v) {
+  hash = hash_float(hash, v->x);
+  hash = hash_float(hash, v->y);
+  return hash_float(hash, v->z);
+}
+
+// Position of a model in the table below, or the table's length for one not
+// in it: an identity that, unlike its address, native and cart builds share.
+static uint32_t model_index(const model_t *model) {
+  static const model_t *const models[] = {&flag_model, &cube_model,
+                                          &tank_model, &projectile_model};
+  uint32_t count = sizeof(models) / sizeof(models[0]);
+  for (uint32_t i = 0; i < count; i++) {
+    if (models[i] == model) {
+      return i;
+    }
+  }
+  return count;
+}
+
+uint32_t hash_object(uint32_t hash, const object_t *obj) {
+  hash = hash_word(hash, model_index(obj->model));
+  hash = hash_vec3f(hash, &obj->pos);
+  hash = hash_float(hash, obj->rot_y);
+  hash = hash_float(hash, obj->scale);
+  hash = hash_float(hash, obj->spawn_time);
+  return hash_word(hash, obj->tag);
+}
+
+uint32_t hash_camera(uint32_t hash, const camera_t *camera) {
+  hash = hash_vec3f(hash, &camera->pos);
+  hash = hash_float(hash, camera->yaw);
+  return hash_float(hash, camera->pitch);
+}
+
+uint32_t hash_game(const game_t *game) {
+  uint32_t hash = hash_word(HASH_SEED, game->tick);
+  hash = hash_word(hash, (uint32_t)game->object_count);
+  for (size_t i = 0; i < game->object_count; i++) {
+    hash = hash_object(hash, &game->objects[i]);
+  }
+  // Only the players in the match: init_game() leaves the others as an
+  // earlier, bigger match left them.
+  for (int i = 0; i < game->selected_players && i < PLAYER_COUNT; i++) {
+    hash = hash_camera(hash, &game->cameras[i]);
+    hash = hash_word(hash, game->score[i]);
+    hash = hash_float(hash, game->shot_time[i]);
+  }
+  return hash;
+}
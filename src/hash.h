@@ -0,0 +1,35 @@
+#ifndef HASH_H_INCLUDED
+#define HASH_H_INCLUDED
+
+#include "game.h"
+#include <stdint.h>
+
+// Ticks between state hash traces, 0 disables tracing. Debug builds trace
+// once per second, release builds only when asked to (make HASH_TRACE=n).
+#ifndef STATE_HASH_TRACE_INTERVAL
+#ifdef DEBUG
+#define STATE_HASH_TRACE_INTERVAL 60
+#else
+#define STATE_HASH_TRACE_INTERVAL 0
+#endif
+#endif
+
+#define HASH_SEED 0x811c9dc5u
+
+// Word-at-a-time hashing, two operations per word. Floats are hashed by
+// their bit pattern, so any divergence between netplay peers shows up.
+uint32_t hash_word(uint32_t hash, uint32_t word);
+uint32_t hash_float(uint32_t hash, float value);
+uint32_t hash_vec3f(uint32_t hash, const vec3f_t *v);
+uint32_t hash_object(uint32_t hash, const object_t *obj);
+uint32_t hash_camera(uint32_t hash, const camera_t *camera);
+
+// Hash of everything in the game state that the simulation touches,
+// recomputed in full every tick rather than kept up to date where the state
+// changes: the tick, every projectile and every moving tank and camera
+// change each tick anyway, and a full pass over at most OBJECTS_LEN objects
+// is a few hundred words, against mutation sites spread all over game.c
+// that would each have to remember to update it.
+uint32_t hash_game(const game_t *game);
+
+#endif
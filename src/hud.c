@@ -0,0 +1,41 @@
+#include "hud.h"
+
+// Digits of the largest int.
+#define MAX_DIGITS 10
+
+int format_uint(char *dest, int value, int digits) {
+  char reversed[MAX_DIGITS];
+  int len = 0;
+  do {
+    reversed[len++] = (char)('0' + value % 10);
+    value /= 10;
+  } while ((value > 0 || len < digits) && len < MAX_DIGITS);
+  for (int i = 0; i < len; i++) {
+    dest[i] = reversed[len - 1 - i];
+  }
+  dest[len] = '\0';
+  return len;
+}
+
+// Appends as much of src as fits.
+static void append(hud_text_t *hud, const char *src) {
+  while (*src != '\0' && hud->len < HUD_TEXT_LEN - 1) {
+    hud->text[hud->len++] = *src++;
+  }
+  hud->text[hud->len] = '\0';
+}
+
+const char *hud_text(hud_text_t *hud, const char *prefix, int value,
+                     int digits, const char *suffix) {
+  if (hud->len != 0 && hud->value == value) {
+    return hud->text;
+  }
+  char number[MAX_DIGITS + 1];
+  format_uint(number, value, digits);
+  hud->value = value;
+  hud->len = 0;
+  append(hud, prefix);
+  append(hud, number);
+  append(hud, suffix);
+  return hud->text;
+}
@@ -0,0 +1,27 @@
+#ifndef HUD_H_INCLUDED
+#define HUD_H_INCLUDED
+
+#include <stdint.h>
+
+// Scores, shot cooldowns and the win countdown change a few times a match
+// but are drawn every frame. Each such string is kept formatted with the
+// value it shows and only formatted again, without printf, once the value
+// changes.
+#define HUD_TEXT_LEN 16
+
+typedef struct {
+  int value;
+  uint8_t len; // 0 until first formatted.
+  char text[HUD_TEXT_LEN];
+} hud_text_t;
+
+// Writes a value >= 0 in decimal, zero padded to at least digits (up to 10),
+// and a terminating NUL. Returns the length.
+int format_uint(char *dest, int value, int digits);
+
+// Sets hud to prefix, value and suffix unless it shows value already, and
+// returns its text. The prefix and suffix of a hud_text_t never change.
+const char *hud_text(hud_text_t *hud, const char *prefix, int value,
+                     int digits, const char *suffix);
+
+#endif
@@ -1,282 +1,626 @@
 #include "wasm4.h"
 
+#include "arena.h"
+#include "game.h"
+#include "hash.h"
+#include "hud.h"
 #include "menu.h"
-#include "models.h"
-#include "nanoprintf.h"
 #include "object.h"
+#include "panorama.h"
+#include "particles.h"
 #include "render.h"
+#include "replay.h"
+#include "yaw_cache.h"
 #include <math.h>
 #include <stdint.h>
-
-#define TEXT_BUFFER_LEN 256
-#define POLYGON_BUFFER_LEN 1024
-#define OBJECTS_LEN 128
-#define CAMERA_OFFSET 15.f
-#define PLAYER_COUNT 4
-
-#define TANK_SCALE 2.f
-#define TANK_COLLISION_RADIUS (TANK_SCALE * 5.f)
-
-#define SHOT_DELAY 3.f
-
-char text_buffer[TEXT_BUFFER_LEN];
-polygon_t polygon_buffer[POLYGON_BUFFER_LEN];
-object_t objects[OBJECTS_LEN];
-camera_t cameras[PLAYER_COUNT];
-uint16_t score[PLAYER_COUNT] = {0, 0, 0, 0};
-size_t object_count = 0;
-float shot_time[4] = {-SHOT_DELAY, -SHOT_DELAY, -SHOT_DELAY, -SHOT_DELAY};
-uint32_t tick = 0;
-uint32_t mountain_seed = 0;
-
-void transformation_debug(object_t *obj, size_t obj_idx __attribute__((unused)),
-                          float time) {
-  obj->pos.x = cosf(time * M_PI) * 30;
-  obj->rot_y = 2.f * M_PI * time / 2.0f;
-  obj->scale = 0.5f + 0.5f * sinf(2 * time * M_PI);
+#include <string.h>
+
+// Polygons per view. Room for every tank up close, the cube and a volley of
+// shells in every view; past that, the polygon budget degrades or drops the
+// least important objects.
+#define POLYGON_BUFFER_LEN 256
+
+#ifdef HALF_RES
+// make HALF_RES=1: a full-screen view rasterizes its scene at half the
+// resolution, a quarter of the pixels to fill, and doubles it into the
+// framebuffer before its HUD goes on top. Split-screen views are that size
+// already and are drawn as they are.
+#define HALF_SIZE (SCREEN_SIZE / 2)
+static uint8_t half_image[HALF_SIZE * HALF_SIZE / 4];
+#endif
+
+static game_t game;
+uint32_t state_hash = HASH_SEED;
+static replay_recorder_t recorder;
+
+// Render results kept across frames for tanks and cameras the simulation
+// hasn't touched since they were built (see changed_tick). Tanks own object
+// slots 0..players-1 and remove_object() never moves them, so the slot keys
+// the cache. Projectiles and the cube change every tick and aren't cached.
+#define TANK_CACHE_VERTS 24
+
+typedef struct {
+  const model_t *model; // LOD the entry was built for, NULL when empty.
+  uint32_t tick;        // Last simulated tick when it was built.
+  vec3f_t world[TANK_CACHE_VERTS];
+} tank_cache_t;
+
+// One tank as seen by one view. buffer_model() only reads the depth of
+// camera-space vertices, so that is all that's kept of them.
+typedef struct {
+  const model_t *model;
+  uint32_t tick;
+  float depth[TANK_CACHE_VERTS];
+  vec2i_t raster[TANK_CACHE_VERTS];
+} tank_view_cache_t;
+
+typedef struct {
+  size_t player_id;
+  viewport_t view;
+  uint32_t tick; // When world_to_camera was built, if ready.
+  int ready;
+  affine_t world_to_camera;
+  tank_view_cache_t tanks[PLAYER_COUNT];
+} view_cache_t;
+
+static tank_cache_t tank_cache[PLAYER_COUNT];
+static view_cache_t view_cache[PLAYER_COUNT];
+
+static hud_text_t score_text[PLAYER_COUNT];
+static hud_text_t cooldown_text[PLAYER_COUNT];
+
+// What the polygon budget cut from the last frame drawn.
+static budget_report_t budget_report;
+
+void start() {
+  init_menu_system(&game);
+  yaw_cache_init();
+#ifdef DEBUG
+  tracef("game state: %d bytes", (int)game_state_size());
+#endif
 }
 
-void init_game() {
-  object_count = 0;
-  mountain_seed = tick * 1234567891u; // Generate seed based on current tick
-  for (int i = 0; i < PLAYER_COUNT; i++) {
-    score[i] = 0;
-    shot_time[i] = -SHOT_DELAY;
-  }
-
-  // Spawn tanks based on selected player count
-  float positions[][2] = {{100, 100}, {-100, 100}, {100, -100}, {-100, -100}};
-  float rotations[] = {0.75f * M_PI, 0.25f * M_PI, -0.75f * M_PI,
-                       -0.25f * M_PI};
-
-  for (int i = 0; i < selected_players; i++) {
-    spawn_object(&tank_model, positions[i][0], 0, positions[i][1], rotations[i],
-                 TANK_SCALE, 0.f, NULL, objects, &object_count, OBJECTS_LEN);
+size_t current_player_id() {
+  if (*NETPLAY & 0b100) {
+    size_t netplay_id = *NETPLAY & 0b011;
+    return (netplay_id < (size_t)game.selected_players) ? netplay_id : 0;
   }
+  return 0;
+}
 
-  spawn_object(&cube_model, 0, 0, 0, 0, 1.f, 0.f, transformation_debug, objects,
-               &object_count, OBJECTS_LEN);
-
-  for (int i = 0; i < selected_players; i++) {
-    cameras[i].pos = objects[i].pos;
-    cameras[i].pos.y = CAMERA_OFFSET;
-    cameras[i].yaw = -objects[i].rot_y;
-    cameras[i].pitch = 0.f;
-    cameras[i].movement_speed = 0.5f;
-    cameras[i].rotation_speed = 0.05f;
+// Split screen is for couch play; under netplay every peer has its own screen.
+int is_split_screen() { return game.split_screen && !(*NETPLAY & 0b100); }
+
+// Lays out one 80x80 viewport per player: side by side for two players, a
+// 2x2 grid for three or four.
+size_t split_viewports(viewport_t views[PLAYER_COUNT]) {
+  size_t count = game.selected_players;
+  for (size_t i = 0; i < count; i++) {
+    views[i].x = (i % 2) * (SCREEN_SIZE / 2);
+    views[i].y = (count == 2) ? SCREEN_SIZE / 4 : (i / 2) * (SCREEN_SIZE / 2);
+    views[i].w = SCREEN_SIZE / 2;
+    views[i].h = SCREEN_SIZE / 2;
   }
+  return count;
 }
 
-void start() { init_menu_system(); }
-
-void update_explosion(object_t *obj, size_t obj_idx, float time) {
-  float life_time = time - obj->spawn_time;
-  obj->scale = 4.f + sinf(life_time * M_PI / 0.5f) * 20.f;
-  if (life_time >= 0.5f) {
-    remove_object(objects, obj_idx, &object_count);
+// The viewport, in the draw target, a view's scene is rasterized into.
+viewport_t scene_viewport(const viewport_t *view) {
+#ifdef HALF_RES
+  if (view->w == SCREEN_SIZE && view->h == SCREEN_SIZE) {
+    return (viewport_t){0, 0, HALF_SIZE, HALF_SIZE};
   }
+#endif
+  return *view;
 }
 
-void update_projectile(object_t *obj, size_t obj_idx, float time) {
-  float cos_yaw = cosf(-obj->rot_y);
-  float sin_yaw = sinf(-obj->rot_y);
-  float speed = 2.f;
-  vec3f_t forward = {cos_yaw, 0, sin_yaw};
-  obj->pos.x += forward.x * speed;
-  obj->pos.z += forward.z * speed;
+// One object or particle in a view's back to front drawing order.
+typedef struct {
+  float depth;
+  size_t index; // An object, or object_count plus a particle.
+} draw_item_t;
+
+// The most objects and vertices a frame draws: every tank at full detail,
+// the cube, two shells per player (one shot per SHOT_DELAY, each flying
+// about as long) and a full particle pool.
+#define FRAME_OBJECTS (PLAYER_COUNT + 1 + 2 * PLAYER_COUNT)
+#define FRAME_VERTS                                                          \
+  (PLAYER_COUNT * TANK_CACHE_VERTS + 8 + 2 * PLAYER_COUNT * 8 +            \
+   PARTICLES_LEN)
+
+// The most draw_game() and draw_view() take from the frame arena at once:
+// the frame's per-object arrays and world-space vertices, then a view's
+// projected vertices, drawing order, polygon list and coverage rows.
+#define FRAME_SCRATCH_SIZE                                                  \
+  (ARENA_ROUND(FRAME_OBJECTS * sizeof(model_t *)) +                         \
+   ARENA_ROUND(FRAME_OBJECTS * sizeof(size_t)) +                            \
+   ARENA_ROUND(FRAME_OBJECTS * sizeof(budget_item_t)) +                     \
+   ARENA_ROUND(FRAME_OBJECTS * sizeof(vec3f_t)) +                           \
+   ARENA_ROUND(FRAME_VERTS * sizeof(vec3f_t)) +                             \
+   ARENA_ROUND(FRAME_VERTS * sizeof(vec3f_t)) +                             \
+   ARENA_ROUND(FRAME_VERTS * sizeof(vec2i_t)) +                             \
+   ARENA_ROUND((FRAME_OBJECTS + PARTICLES_LEN) * sizeof(draw_item_t)) +     \
+   ARENA_ROUND(POLYGON_BUFFER_LEN * sizeof(polygon_t)) +                    \
+   ARENA_ROUND(SCREEN_SIZE * sizeof(coverage_row_t)))
+_Static_assert(FRAME_SCRATCH_SIZE <= FRAME_ARENA_SIZE,
+               "FRAME_ARENA_SIZE too small for POLYGON_BUFFER_LEN");
+
+int compare_items(const void *a, const void *b) {
+  const draw_item_t *i1 = (const draw_item_t *)a;
+  const draw_item_t *i2 = (const draw_item_t *)b;
+  return (i1->depth > i2->depth) - (i1->depth < i2->depth);
+}
 
-  if (time - obj->spawn_time > 3.f) {
-    remove_object(objects, obj_idx, &object_count);
-  } else {
-    for (int i = 0; i < selected_players; i++) {
-      uint8_t owner = obj->tag;
-      if (owner == i) {
-        continue; // Not colliding with the player who shot.
-      } else {
-        object_t *tank = &objects[i];
-        float distance = vec3f_xz_distance(obj->pos, tank->pos);
-        if (distance < TANK_COLLISION_RADIUS) {
-          spawn_object(&explosion_model, obj->pos.x, 8.f * TANK_SCALE,
-                       obj->pos.z, 0, 4.f, time, update_explosion, objects,
-                       &object_count, OBJECTS_LEN);
-          remove_object(objects, obj_idx, &object_count);
-          score[owner]++;
-          tone(300 | (110 << 16), 30, 40, 3);
-
-          // Check win condition
-          if (score[owner] >= WIN_SCORE) {
-            winner = owner;
-            game_state = GAME_STATE_WIN;
-            win_timer = 0;
-          }
-          break;
-        }
-      }
+// Projects a tank for a view, or reuses last frame's projection when
+// neither the tank nor the camera changed.
+void project_tank(view_cache_t *cache, size_t slot, const model_t *model,
+                  const vec3f_t *world, uint32_t tick, vec3f_t *camera_verts,
+                  vec2i_t *raster_verts) {
+  tank_view_cache_t *entry = &cache->tanks[slot];
+  size_t count = model->verts_count;
+  if (entry->model == model &&
+      game.objects[slot].changed_tick <= entry->tick &&
+      game.cameras[cache->player_id].changed_tick <= entry->tick) {
+    for (size_t i = 0; i < count; i++) {
+      camera_verts[i].z = entry->depth[i];
+      raster_verts[i] = entry->raster[i];
     }
+    return;
   }
-}
 
-size_t current_player_id() {
-  if (*NETPLAY & 0b100) {
-    size_t netplay_id = *NETPLAY & 0b011;
-    return (netplay_id < (size_t)selected_players) ? netplay_id : 0;
+  project_vertices(world, count, &cache->world_to_camera, &cache->view,
+                   camera_verts, raster_verts);
+  if (count > TANK_CACHE_VERTS) {
+    entry->model = NULL;
+    return;
+  }
+  entry->model = model;
+  entry->tick = tick;
+  for (size_t i = 0; i < count; i++) {
+    entry->depth[i] = camera_verts[i].z;
+    entry->raster[i] = raster_verts[i];
   }
-  return 0;
 }
 
-void handle_camera_movement(uint8_t gamepad, camera_t *camera) {
-  // Calculate forward and right vectors based on camera orientation
-  float cos_yaw = cosf(camera->yaw);
-  float sin_yaw = sinf(camera->yaw);
+// Draws the world as seen by one player into a viewport. Only projection,
+// sorting and rasterization run per view; the world-space vertices are
+// shared by all of them.
+void draw_view(view_cache_t *cache, size_t player_id, const viewport_t *view,
+               const model_t **models, const vec3f_t *lights,
+               const vec3f_t *world_verts, const size_t *vert_base,
+               size_t vert_count) {
+  size_t mark = arena_mark(&frame_arena);
+  // The tick that was just simulated.
+  uint32_t tick = game.tick - 1;
+  float time = tick / 60.f;
+  const camera_t *camera = &game.cameras[player_id];
+  viewport_t scene = scene_viewport(view);
+#ifdef HALF_RES
+  if (scene.w != view->w) {
+    // The runtime only clears the framebuffer; the panorama leaves the sky
+    // above it as it was, so last frame's image goes first.
+    set_target(half_image, HALF_SIZE / 4);
+    memset(half_image, 0, sizeof(half_image));
+  }
+#endif
 
-  vec3f_t forward = {cos_yaw, 0, sin_yaw};
+  panorama_draw(&scene, camera->yaw);
 
-  // Move forward/backward (UP/DOWN)
-  if (gamepad & BUTTON_UP) {
-    camera->pos.x += forward.x * camera->movement_speed;
-    camera->pos.y += forward.y * camera->movement_speed;
-    camera->pos.z += forward.z * camera->movement_speed;
+  if (cache->player_id != player_id || cache->view.x != scene.x ||
+      cache->view.y != scene.y || cache->view.w != scene.w ||
+      cache->view.h != scene.h) {
+    memset(cache, 0, sizeof(*cache));
+    cache->player_id = player_id;
+    cache->view = scene;
   }
-  if (gamepad & BUTTON_DOWN) {
-    camera->pos.x -= forward.x * camera->movement_speed;
-    camera->pos.y -= forward.y * camera->movement_speed;
-    camera->pos.z -= forward.z * camera->movement_speed;
+  if (!cache->ready || camera->changed_tick > cache->tick) {
+    affine_t camera_to_world = build_camera_transform(camera);
+    cache->world_to_camera = affine_inverse(&camera_to_world);
+    cache->tick = tick;
+    cache->ready = 1;
   }
 
-  float rotation_speed = camera->rotation_speed;
-  if (gamepad & BUTTON_1) {
-    rotation_speed /= 2.f;
+  vec3f_t *camera_verts =
+      arena_alloc(&frame_arena, vert_count * sizeof(vec3f_t));
+  vec2i_t *raster_verts =
+      arena_alloc(&frame_arena, vert_count * sizeof(vec2i_t));
+  if (camera_verts == NULL || raster_verts == NULL) {
+    arena_release(&frame_arena, mark);
+    return;
   }
-  if (gamepad & BUTTON_LEFT) {
-    camera->yaw += rotation_speed;
+  set_clip(&scene);
+  size_t tank_count = game.selected_players;
+  if (tank_count > game.object_count) {
+    tank_count = game.object_count;
   }
-  if (gamepad & BUTTON_RIGHT) {
-    camera->yaw -= rotation_speed;
+  for (size_t i = 0; i < tank_count; i++) {
+    if (models[i] != NULL && i != player_id) {
+      project_tank(cache, i, models[i], &world_verts[vert_base[i]], tick,
+                   &camera_verts[vert_base[i]], &raster_verts[vert_base[i]]);
+    }
   }
-}
+  // Everything after the tanks, particles last, changes every tick.
+  size_t particle_base = vert_count - game.particles.count;
+  size_t first = tank_count < game.object_count ? vert_base[tank_count]
+                                                : particle_base;
+  project_vertices(&world_verts[first], vert_count - first,
+                   &cache->world_to_camera, &scene, &camera_verts[first],
+                   &raster_verts[first]);
+
+#if RENDER_ORDER != ORDER_TRIANGLES
+  // Objects and particles back to front. Polygons are then buffered in that
+  // order and only sorted within models that aren't convex.
+  draw_item_t *items = arena_alloc(
+      &frame_arena,
+      (game.object_count + game.particles.count) * sizeof(draw_item_t));
+  if (items == NULL) {
+    arena_release(&frame_arena, mark);
+    return;
+  }
+  size_t item_count = 0;
+  for (size_t i = 0; i < game.object_count; i++) {
+    if ((i < (size_t)game.selected_players && i == player_id) ||
+        models[i] == NULL) {
+      continue;
+    }
+    const vec3f_t *verts = &camera_verts[vert_base[i]];
+    float depth = 0.0f;
+    for (size_t v = 0; v < models[i]->verts_count; v++) {
+      depth += verts[v].z;
+    }
+    items[item_count].depth = depth / models[i]->verts_count;
+    items[item_count].index = i;
+    item_count++;
+  }
+  for (size_t i = 0; i < game.particles.count; i++) {
+    items[item_count].depth = camera_verts[particle_base + i].z;
+    items[item_count].index = game.object_count + i;
+    item_count++;
+  }
+  qsort(items, item_count, sizeof(draw_item_t), compare_items);
+#endif
 
-void update_game() {
-  float time = tick / 60.f;
+  // The polygon list takes whatever is left, up to the polygon budget.
+  size_t buf_len;
+  polygon_t *polygons = arena_alloc_rest(&frame_arena, sizeof(polygon_t),
+                                         POLYGON_BUFFER_LEN, &buf_len);
 
-  // Input and game logic.
-  size_t player_id = current_player_id();
-  for (int i = 0; i < selected_players; i++) {
-    const uint8_t pad = *(GAMEPAD1 + i);
-    object_t *player_object = &objects[i];
-    handle_camera_movement(pad, &cameras[i]);
-    player_object->pos = cameras[i].pos;
-    player_object->pos.y -= CAMERA_OFFSET;
-    player_object->rot_y = -cameras[i].yaw;
-    if (pad & BUTTON_2 && time - shot_time[i] > SHOT_DELAY) {
-      shot_time[i] = time;
-      object_t *obj = spawn_object(
-          &projectile_model, player_object->pos.x, player_object->pos.y,
-          player_object->pos.z, player_object->rot_y, TANK_SCALE, time,
-          update_projectile, objects, &object_count, OBJECTS_LEN);
-      tone(60 | (40 << 16), 10, 40, 0); // Low-frequency pulse wave
-      obj->tag = (uint8_t)i;
+  size_t buf_idx = 0;
+#if RENDER_ORDER != ORDER_TRIANGLES
+  // Room the objects still to come were budgeted, kept from particles.
+  size_t reserved = 0;
+  for (size_t k = 0; k < item_count; k++) {
+    if (items[k].index < game.object_count) {
+      reserved += model_polygons(models[items[k].index]);
+    }
+  }
+  for (size_t k = 0; k < item_count; k++) {
+    size_t i = items[k].index;
+    if (i >= game.object_count) {
+      size_t room = buf_len > reserved ? buf_len - reserved : 0;
+      if (buf_idx >= room) {
+        budget_report.particles++;
+        continue;
+      }
+      particles_buffer(&game.particles, i - game.object_count, 1,
+                       &camera_verts[particle_base],
+                       &raster_verts[particle_base], scene.h / 2.f,
+                       FAR_PLANE, polygons, &buf_idx, room);
+      continue;
+    }
+    reserved -= model_polygons(models[i]);
+    size_t start = buf_idx;
+    buffer_model(models[i], &lights[i], &camera_verts[vert_base[i]],
+                 &raster_verts[vert_base[i]], FAR_PLANE, polygons, &buf_idx,
+                 buf_len);
+    if (!(models[i]->flags & MODEL_CONVEX)) {
+      sort_polygons(&polygons[start], buf_idx - start);
+    }
+  }
+#else
+  size_t i = game.object_count;
+  while (i-- > 0) {
+    // Skip the player's own tank (first selected_players objects are tanks)
+    if (i < (size_t)game.selected_players && i == player_id) {
+      continue;
     }
+    if (models[i] == NULL) {
+      continue;
+    }
+    buffer_model(models[i], &lights[i], &camera_verts[vert_base[i]],
+                 &raster_verts[vert_base[i]], FAR_PLANE, polygons, &buf_idx,
+                 buf_len);
   }
+  particles_buffer(&game.particles, 0, game.particles.count,
+                   &camera_verts[particle_base], &raster_verts[particle_base],
+                   scene.h / 2.f, FAR_PLANE, polygons, &buf_idx, buf_len);
+  sort_polygons(polygons, buf_idx);
+#endif
+
+  arena_trim(&frame_arena, polygons, buf_idx * sizeof(polygon_t));
 
-  // Rendering.
-  *DRAW_COLORS = 2;
-  rect(0, 80, 160, 80);
+  *DRAW_COLORS = 0x43;
+#if RENDER_ORDER == ORDER_SPANS
+  coverage_row_t *rows =
+      arena_alloc(&frame_arena, scene.h * sizeof(coverage_row_t));
+  if (rows != NULL) {
+    render_buffer_front_to_back(polygons, buf_idx, rows, scene.h);
+  } else {
+    render_buffer(polygons, buf_idx);
+  }
+#else
+  render_buffer(polygons, buf_idx);
+#endif
+
+#ifdef HALF_RES
+  if (scene.w != view->w) {
+    set_target(FRAMEBUFFER, SCREEN_SIZE / 4);
+    blit_doubled(half_image, HALF_SIZE, HALF_SIZE, view->x, view->y);
+  }
+#endif
+
+  // UI.
+  *DRAW_COLORS = 0x42;
+  rect(view->x + view->w / 2 - 2, view->y + view->h / 2 - 4, 4, 4);
 
-  // Draw mountain silhouette
   *DRAW_COLORS = 3;
-  for (int x = 0; x < 160; x++) {
-    float relative_angle = (x - 80) * (M_PI / 2) / 80;
-    float world_angle = relative_angle - cameras[player_id].yaw / 4;
+  int text_x = view->x + view->w / 2 - FONT_SIZE;
+  int text_y = view->y + view->h - FONT_SIZE;
+  float shot_cooldown = time - game.shot_time[player_id];
+  if (shot_cooldown > SHOT_DELAY) {
+    text("OK", text_x, text_y);
+  } else {
+    int seconds = (int)(1 + SHOT_DELAY - shot_cooldown);
+    text(hud_text(&cooldown_text[player_id], "", seconds, 2, ""), text_x,
+         text_y);
+  }
 
-    // Generate mountain height using multiple sine waves with random offsets
-    float seed_offset1 = (mountain_seed & 0xFF) / 255.0f * M_PI * 2;
-    float seed_offset2 = ((mountain_seed >> 8) & 0xFF) / 255.0f * M_PI * 2;
-    float seed_offset3 = ((mountain_seed >> 16) & 0xFF) / 255.0f * M_PI * 2;
-    float height = 8 + 6 * sinf(world_angle * 3 + seed_offset1) +
-                   4 * sinf(world_angle * 7 + seed_offset2) +
-                   2 * sinf(world_angle * 13 + seed_offset3);
-    if (height < 1)
-      height = 1;
+  viewport_t screen = {0, 0, SCREEN_SIZE, SCREEN_SIZE};
+  set_clip(&screen);
+  arena_release(&frame_arena, mark);
+}
 
-    vline(x, 80 - (int)height, (int)height);
+void draw_game() {
+  // Bakes the horizon on the first frame of a match.
+  panorama_update(game.mountain_seed);
+
+  viewport_t views[PLAYER_COUNT];
+  size_t view_players[PLAYER_COUNT];
+  size_t view_count;
+  if (is_split_screen()) {
+    view_count = split_viewports(views);
+    for (size_t i = 0; i < view_count; i++) {
+      view_players[i] = i;
+    }
+  } else {
+    view_count = 1;
+    views[0] = (viewport_t){0, 0, SCREEN_SIZE, SCREEN_SIZE};
+    view_players[0] = current_player_id();
   }
-  matrix44f_t camera_to_world = build_camera_matrix(&cameras[player_id]);
-  matrix44f_t world_to_camera = inverse_matrix44f(&camera_to_world);
 
-  size_t buf_idx = 0;
-  static matrix44f_t transform;
-  size_t i = object_count;
-  while (i-- > 0) {
-    // Skip the current player's tank (first selected_players objects are tanks)
-    if (i < (size_t)selected_players && i == player_id) {
-      continue;
+  const model_t **models =
+      arena_alloc(&frame_arena, game.object_count * sizeof(model_t *));
+  size_t *vert_base =
+      arena_alloc(&frame_arena, game.object_count * sizeof(size_t));
+  budget_item_t *budget =
+      arena_alloc(&frame_arena, game.object_count * sizeof(budget_item_t));
+  if (models == NULL || vert_base == NULL || budget == NULL) {
+    return;
+  }
+
+  // One level of detail per object for the frame, picked for the view that
+  // sees it largest, so all views can share its world-space vertices.
+  size_t budget_count = 0;
+  for (size_t i = 0; i < game.object_count; i++) {
+    const object_t *object = &game.objects[i];
+    float radius = object->model->radius * object->scale;
+    float projected_radius = -1.f; // Beyond the far plane of every view.
+    for (size_t v = 0; v < view_count; v++) {
+      if (i < (size_t)game.selected_players && i == view_players[v]) {
+        continue; // A view never draws its own tank.
+      }
+      vec3f_t eye = game.cameras[view_players[v]].pos;
+      float dx = object->pos.x - eye.x;
+      float dy = object->pos.y - eye.y;
+      float dz = object->pos.z - eye.z;
+      float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+      if (distance - radius > FAR_PLANE) {
+        continue;
+      }
+      // Viewports project with a canvas of 2 units, so half their height
+      // in pixels per unit at distance 1.
+      int height = scene_viewport(&views[v]).h;
+      float pixels =
+          distance > radius ? radius * (height / 2) / distance : (float)height;
+      if (pixels > projected_radius) {
+        projected_radius = pixels;
+      }
+    }
+    models[i] = projected_radius < 0.f
+                    ? NULL
+                    : select_lod(object->model, projected_radius);
+    if (models[i] != NULL) {
+      // Tanks are what the players shoot at, so they claim room first, then
+      // everything else by size on screen.
+      int is_tank = i < (size_t)game.selected_players;
+      budget[budget_count++] = (budget_item_t){
+          models[i], projected_radius + (is_tank ? SCREEN_SIZE * 2 : 0), i};
     }
-    object_t *object = &objects[i];
-    object_matrix(object, &transform);
-    buffer_model(object->model, &transform, &world_to_camera, polygon_buffer,
-                 &buf_idx, POLYGON_BUFFER_LEN);
-    object_update(object, i, time);
   }
 
-  *DRAW_COLORS = 0x43;
-  render_buffer(polygon_buffer, buf_idx);
+  // Every view draws a subset of the frame's objects, so fitting them all
+  // into one polygon list leaves room in each view's. Particles get what
+  // the objects leave.
+  budget_report = (budget_report_t){0};
+  fit_polygon_budget(budget, budget_count, POLYGON_BUFFER_LEN,
+                     &budget_report);
+  for (size_t k = 0; k < budget_count; k++) {
+    models[budget[k].index] = budget[k].model;
+  }
+  vec3f_t *lights =
+      arena_alloc(&frame_arena, game.object_count * sizeof(vec3f_t));
+  if (lights == NULL) {
+    return;
+  }
+  size_t vert_count = 0;
+  for (size_t i = 0; i < game.object_count; i++) {
+    vert_base[i] = vert_count;
+    if (models[i] != NULL) {
+      vert_count += models[i]->verts_count;
+      lights[i] = model_light(game.objects[i].rot_y);
+    }
+  }
 
-  // UI.
-  *DRAW_COLORS = 0x42;
-  rect(78, 76, 4, 4);
+  // World-space vertices of every object, transformed once per frame, then
+  // one per particle.
+  size_t particle_base = vert_count;
+  vert_count += game.particles.count;
+  vec3f_t *world_verts =
+      arena_alloc(&frame_arena, vert_count * sizeof(vec3f_t));
+  if (world_verts == NULL) {
+    return;
+  }
+  particles_world(&game.particles, &world_verts[particle_base]);
+  uint32_t tick = game.tick - 1;
+  for (size_t i = 0; i < game.object_count; i++) {
+    if (models[i] == NULL) {
+      continue;
+    }
+    vec3f_t *dest = &world_verts[vert_base[i]];
+    size_t count = models[i]->verts_count;
+    if (i >= (size_t)game.selected_players || i >= PLAYER_COUNT ||
+        count > TANK_CACHE_VERTS) {
+      object_world_verts(&game.objects[i], models[i], dest);
+      continue;
+    }
+    tank_cache_t *entry = &tank_cache[i];
+    if (entry->model != models[i] ||
+        game.objects[i].changed_tick > entry->tick) {
+      object_world_verts(&game.objects[i], models[i], entry->world);
+      entry->model = models[i];
+      entry->tick = tick;
+    }
+    memcpy(dest, entry->world, count * sizeof(vec3f_t));
+  }
+
+  for (size_t i = 0; i < view_count; i++) {
+    draw_view(&view_cache[i], view_players[i], &views[i], models, lights,
+              world_verts, vert_base, vert_count);
+  }
 
   *DRAW_COLORS = 3;
-  int text_len;
+  static const char *const score_prefix[PLAYER_COUNT] = {"P1: ", "P2: ",
+                                                         "P3: ", "P4: "};
 
   // Only show scores for active players
-  for (int i = 0; i < selected_players; i++) {
-    text_len = npf_snprintf(text_buffer, sizeof(text_buffer), "P%d: %02d",
-                            i + 1, score[i]);
+  for (int i = 0; i < game.selected_players; i++) {
+    hud_text_t *score = &score_text[i];
+    hud_text(score, score_prefix[i], game.score[i], 2, "");
+    int right = SCREEN_SIZE - score->len * FONT_SIZE;
 
     if (i == 0) {
-      text(text_buffer, 1, 1);
+      text(score->text, 1, 1);
     } else if (i == 1) {
-      text(text_buffer, SCREEN_SIZE - text_len * FONT_SIZE, 1);
+      text(score->text, right, 1);
     } else if (i == 2) {
-      text(text_buffer, 1, SCREEN_SIZE - FONT_SIZE);
+      text(score->text, 1, SCREEN_SIZE - FONT_SIZE);
     } else if (i == 3) {
-      text(text_buffer, SCREEN_SIZE - text_len * FONT_SIZE,
-           SCREEN_SIZE - FONT_SIZE);
+      text(score->text, right, SCREEN_SIZE - FONT_SIZE);
     }
   }
+}
 
-  float shot_cooldown = time - shot_time[current_player_id()];
-  if (shot_cooldown > SHOT_DELAY) {
-    text("OK", SCREEN_SIZE / 2 - FONT_SIZE, SCREEN_SIZE - FONT_SIZE);
-  } else {
-    npf_snprintf(text_buffer, sizeof(text_buffer), "%02d",
-                 (int)(1 + SHOT_DELAY - shot_cooldown));
-    text(text_buffer, SCREEN_SIZE / 2 - FONT_SIZE, SCREEN_SIZE - FONT_SIZE);
+#ifdef WASM4_HOST
+void host_draw_game(const game_t *state) {
+  // The native tools draw without running start().
+  static int yaw_cache_ready = 0;
+  if (!yaw_cache_ready) {
+    yaw_cache_init();
+    yaw_cache_ready = 1;
+  }
+  // Ticks only run backwards when a new replay starts; drop the caches.
+  if (state->tick <= game.tick) {
+    memset(tank_cache, 0, sizeof(tank_cache));
+    memset(view_cache, 0, sizeof(view_cache));
+  }
+  game = *state;
+  arena_reset(&frame_arena);
+  draw_game();
+}
+#endif
+
+// Records the pads of every tick played, from the tick that started the
+// match up to the one that ended it, and traces the replay afterwards.
+// Rollback may re-run the end of a match and trace it again; readers keep
+// the last trace for the tick a match started on.
+void record_replay(uint8_t prev_state, uint32_t prev_tick,
+                   const uint8_t pads[PLAYER_COUNT]) {
+  if (prev_state == GAME_STATE_PLAYING) {
+    replay_record(&recorder, pads);
+  }
+  if (game.state == prev_state) {
+    return;
+  }
+  if (game.state == GAME_STATE_PLAYING) {
+    replay_begin(&recorder, prev_tick, game.selected_players);
+  } else if (prev_state == GAME_STATE_PLAYING) {
+    replay_finish(&recorder);
+    replay_trace(&recorder);
   }
 }
 
 void update() {
-  switch (game_state) {
-  case GAME_STATE_MENU:
-    update_menu();
-    draw_menu();
-    break;
-  case GAME_STATE_PLAYER_SELECT:
-    update_player_select();
-    draw_player_select();
-    break;
-  case GAME_STATE_HELP:
-    update_help();
-    draw_help();
-    break;
-  case GAME_STATE_PLAYING:
-    update_game();
-    break;
-  case GAME_STATE_WIN:
-    update_win();
-    draw_win_screen();
-    break;
-  }
-
-  tick++;
+  arena_reset(&frame_arena);
+
+  uint8_t pads[PLAYER_COUNT];
+  for (int i = 0; i < PLAYER_COUNT; i++) {
+    pads[i] = GAMEPAD1[i];
+  }
+  uint8_t prev_state = game.state;
+  uint32_t prev_tick = game.tick;
+  game_update(&game, pads);
+  record_replay(prev_state, prev_tick, pads);
+
+  if (game.state == GAME_STATE_PLAYING) {
+    // The 3D view is drawn from scratch every frame on a cleared screen.
+    // Coming from a menu, the runtime kept the menu for this frame, so it
+    // is cleared here; clearing the flag only takes effect from the next.
+    if (*SYSTEM_FLAGS & SYSTEM_PRESERVE_FRAMEBUFFER) {
+      *SYSTEM_FLAGS &= ~SYSTEM_PRESERVE_FRAMEBUFFER;
+      memset(FRAMEBUFFER, 0, SCREEN_SIZE * SCREEN_SIZE / 4);
+    }
+    draw_game();
+  } else {
+    draw_menu_screen(&game);
+  }
+
+#ifdef DEBUG
+  static uint16_t reported_overflow = 0;
+  uint16_t overflow = budget_report.degraded + budget_report.dropped +
+                      budget_report.particles;
+  if (overflow > reported_overflow) {
+    reported_overflow = overflow;
+    tracef("polygon budget: %d degraded, %d dropped, %d particles dropped",
+           budget_report.degraded, budget_report.dropped,
+           budget_report.particles);
+  }
+  static size_t reported_high_water = 0;
+  if (frame_arena.high_water > reported_high_water) {
+    reported_high_water = frame_arena.high_water;
+    tracef("frame arena: %d / %d bytes", (int)reported_high_water,
+           (int)frame_arena.size);
+  }
+  static size_t reported_failures = 0;
+  if (frame_arena.failures > reported_failures) {
+    reported_failures = frame_arena.failures;
+    tracef("frame arena: %d allocations failed", (int)reported_failures);
+  }
+#endif
+
+  state_hash = hash_game(&game);
+#if STATE_HASH_TRACE_INTERVAL > 0
+  if (game.tick % STATE_HASH_TRACE_INTERVAL == 0) {
+    tracef("state %d %x", (int)game.tick, state_hash);
+  }
+#endif
 }
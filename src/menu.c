@@ -1,45 +1,33 @@
 #include "menu.h"
-#include "nanoprintf.h"
+#include "hud.h"
 #include "wasm4.h"
 #include <string.h>
 
-#define TEXT_BUFFER_LEN 256
-
-// Global menu state variables
-game_state_t game_state = GAME_STATE_MENU;
-int selected_players = 2;
-int menu_selection = 0;
-int winner = -1;
-uint32_t win_timer = 0;
-
-// Global input state to prevent button press carry-over between states
-static uint8_t prev_gamepad = 0;
-static char text_buffer[TEXT_BUFFER_LEN];
-
-void init_menu_system(void) {
-  game_state = GAME_STATE_MENU;
-  selected_players = 2;
-  menu_selection = 0;
-  winner = -1;
-  win_timer = 0;
-  prev_gamepad = 0;
+void init_menu_system(game_t *game) {
+  game->state = GAME_STATE_MENU;
+  game->selected_players = 2;
+  game->menu_selection = 0;
+  game->winner = -1;
+  game->win_timer = 0;
+  game->prev_gamepad = 0;
+  game->split_screen = 0;
 }
 
 void text_center(const char *label, int y) {
   text(label, (SCREEN_SIZE - strlen(label) * FONT_SIZE) / 2, y);
 }
 
-void draw_menu(void) {
+void draw_menu(const game_t *game) {
   *DRAW_COLORS = 2;
   rect(0, 0, SCREEN_SIZE, SCREEN_SIZE);
 
   *DRAW_COLORS = 3;
   text_center("TANK WARS", 20);
 
-  *DRAW_COLORS = (menu_selection == 0) ? 0x41 : 3;
+  *DRAW_COLORS = (game->menu_selection == 0) ? 0x41 : 3;
   text_center("New Game", 60);
 
-  *DRAW_COLORS = (menu_selection == 1) ? 0x41 : 3;
+  *DRAW_COLORS = (game->menu_selection == 1) ? 0x41 : 3;
   text_center("Help", 80);
 
   *DRAW_COLORS = 3;
@@ -47,7 +35,9 @@ void draw_menu(void) {
   text_center("X: Confirm", 130);
 }
 
-void draw_player_select(void) {
+void draw_player_select(const game_t *game) {
+  static const char *const labels[] = {"2 Players", "3 Players",
+                                       "4 Players"};
   *DRAW_COLORS = 2;
   rect(0, 0, SCREEN_SIZE, SCREEN_SIZE);
 
@@ -55,15 +45,16 @@ void draw_player_select(void) {
   text_center("Select Players", 20);
 
   for (int i = 2; i <= 4; i++) {
-    *DRAW_COLORS = (selected_players == i) ? 0x41 : 3;
-    npf_snprintf(text_buffer, sizeof(text_buffer), "%d Players", i);
-    text_center(text_buffer, 40 + (i - 2) * 20);
+    *DRAW_COLORS = (game->selected_players == i) ? 0x41 : 3;
+    text_center(labels[i - 2], 40 + (i - 2) * 20);
   }
 
   *DRAW_COLORS = 3;
-  text_center("Press Enter to", 100);
-  text_center("copy Netplay URL", 110);
-  text_center("UP/DOWN: Select", 130);
+  text_center(game->split_screen ? "Split screen: ON" : "Split screen: OFF",
+              96);
+  text_center("Press Enter to", 110);
+  text_center("copy Netplay URL", 120);
+  text_center("Arrows: Select", 130);
   text_center("X: Start, Z: Back", 140);
 }
 
@@ -95,74 +86,120 @@ void draw_help(void) {
   text_center("Z: Back", y);
 }
 
-void draw_win_screen(void) {
+void draw_win_screen(const game_t *game) {
+  static hud_text_t winner_text;
+  static hud_text_t countdown_text;
   *DRAW_COLORS = 2;
   rect(0, 0, SCREEN_SIZE, SCREEN_SIZE);
 
   *DRAW_COLORS = 3;
-  npf_snprintf(text_buffer, sizeof(text_buffer), "PLAYER %d WINS!", winner + 1);
-  text(text_buffer, 24, 60);
+  text(hud_text(&winner_text, "PLAYER ", game->winner + 1, 1, " WINS!"), 24,
+       60);
 
-  int remaining = (WIN_DELAY - win_timer) / 60 + 1;
-  npf_snprintf(text_buffer, sizeof(text_buffer), "Menu in %d...", remaining);
-  text(text_buffer, 44, 80);
+  int remaining = (WIN_DELAY - game->win_timer) / 60 + 1;
+  text(hud_text(&countdown_text, "Menu in ", remaining, 1, "..."), 44, 80);
 }
 
-void update_menu(void) {
-  const uint8_t pad = *GAMEPAD1;
+// Everything the menu screens show.
+typedef struct {
+  uint8_t state;
+  uint8_t menu_selection;
+  uint8_t selected_players;
+  uint8_t split_screen;
+  int8_t winner;
+  int countdown;
+} menu_view_t;
+
+void draw_menu_screen(const game_t *game) {
+  static menu_view_t drawn;
+  menu_view_t view;
+  memset(&view, 0, sizeof(view)); // Padding too, for memcmp().
+  view.state = game->state;
+  view.menu_selection = game->menu_selection;
+  view.selected_players = game->selected_players;
+  view.split_screen = game->split_screen;
+  view.winner = game->winner;
+  if (game->state == GAME_STATE_WIN) {
+    view.countdown = (WIN_DELAY - game->win_timer) / 60 + 1;
+  }
+  // Without the flag the runtime cleared the screen before this frame.
+  if ((*SYSTEM_FLAGS & SYSTEM_PRESERVE_FRAMEBUFFER) &&
+      memcmp(&view, &drawn, sizeof(view)) == 0) {
+    return;
+  }
+  *SYSTEM_FLAGS |= SYSTEM_PRESERVE_FRAMEBUFFER;
+  drawn = view;
+
+  switch (game->state) {
+  case GAME_STATE_MENU:
+    draw_menu(game);
+    break;
+  case GAME_STATE_PLAYER_SELECT:
+    draw_player_select(game);
+    break;
+  case GAME_STATE_HELP:
+    draw_help();
+    break;
+  case GAME_STATE_WIN:
+    draw_win_screen(game);
+    break;
+  }
+}
 
-  if ((pad & BUTTON_UP) && !(prev_gamepad & BUTTON_UP)) {
-    menu_selection = (menu_selection - 1 + 2) % 2;
+void update_menu(game_t *game, uint8_t pad) {
+  if ((pad & BUTTON_UP) && !(game->prev_gamepad & BUTTON_UP)) {
+    game->menu_selection = (game->menu_selection - 1 + 2) % 2;
   }
-  if ((pad & BUTTON_DOWN) && !(prev_gamepad & BUTTON_DOWN)) {
-    menu_selection = (menu_selection + 1) % 2;
+  if ((pad & BUTTON_DOWN) && !(game->prev_gamepad & BUTTON_DOWN)) {
+    game->menu_selection = (game->menu_selection + 1) % 2;
   }
-  if ((pad & BUTTON_1) && !(prev_gamepad & BUTTON_1)) {
-    if (menu_selection == 0) {
-      game_state = GAME_STATE_PLAYER_SELECT;
+  if ((pad & BUTTON_1) && !(game->prev_gamepad & BUTTON_1)) {
+    if (game->menu_selection == 0) {
+      game->state = GAME_STATE_PLAYER_SELECT;
     } else {
-      game_state = GAME_STATE_HELP;
+      game->state = GAME_STATE_HELP;
     }
   }
 
-  prev_gamepad = pad;
+  game->prev_gamepad = pad;
 }
 
-void update_player_select(void) {
-  const uint8_t pad = *GAMEPAD1;
-
-  if ((pad & BUTTON_UP) && !(prev_gamepad & BUTTON_UP)) {
-    selected_players = (selected_players - 1 < 2) ? 4 : selected_players - 1;
+void update_player_select(game_t *game, uint8_t pad) {
+  if ((pad & BUTTON_UP) && !(game->prev_gamepad & BUTTON_UP)) {
+    game->selected_players =
+        (game->selected_players - 1 < 2) ? 4 : game->selected_players - 1;
+  }
+  if ((pad & BUTTON_DOWN) && !(game->prev_gamepad & BUTTON_DOWN)) {
+    game->selected_players =
+        (game->selected_players + 1 > 4) ? 2 : game->selected_players + 1;
   }
-  if ((pad & BUTTON_DOWN) && !(prev_gamepad & BUTTON_DOWN)) {
-    selected_players = (selected_players + 1 > 4) ? 2 : selected_players + 1;
+  if ((pad & (BUTTON_LEFT | BUTTON_RIGHT)) &&
+      !(game->prev_gamepad & (BUTTON_LEFT | BUTTON_RIGHT))) {
+    game->split_screen = !game->split_screen;
   }
-  if ((pad & BUTTON_1) && !(prev_gamepad & BUTTON_1)) {
-    extern void init_game(void);
-    init_game();
-    game_state = GAME_STATE_PLAYING;
+  if ((pad & BUTTON_1) && !(game->prev_gamepad & BUTTON_1)) {
+    init_game(game);
+    game->state = GAME_STATE_PLAYING;
   }
-  if ((pad & BUTTON_2) && !(prev_gamepad & BUTTON_2)) {
-    game_state = GAME_STATE_MENU;
+  if ((pad & BUTTON_2) && !(game->prev_gamepad & BUTTON_2)) {
+    game->state = GAME_STATE_MENU;
   }
 
-  prev_gamepad = pad;
+  game->prev_gamepad = pad;
 }
 
-void update_help(void) {
-  const uint8_t pad = *GAMEPAD1;
-
-  if ((pad & BUTTON_2) && !(prev_gamepad & BUTTON_2)) {
-    game_state = GAME_STATE_MENU;
+void update_help(game_t *game, uint8_t pad) {
+  if ((pad & BUTTON_2) && !(game->prev_gamepad & BUTTON_2)) {
+    game->state = GAME_STATE_MENU;
   }
 
-  prev_gamepad = pad;
+  game->prev_gamepad = pad;
 }
 
-void update_win(void) {
-  win_timer++;
-  if (win_timer >= WIN_DELAY) {
-    game_state = GAME_STATE_MENU;
-    menu_selection = 0;
+void update_win(game_t *game) {
+  game->win_timer++;
+  if (game->win_timer >= WIN_DELAY) {
+    game->state = GAME_STATE_MENU;
+    game->menu_selection = 0;
   }
 }
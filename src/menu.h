@@ -1,39 +1,29 @@
 #ifndef MENU_H_INCLUDED
 #define MENU_H_INCLUDED
 
+#include "game.h"
 #include <stdint.h>
 
 #define WIN_SCORE 10
 #define WIN_DELAY 180 // 3 seconds at 60fps
 
-typedef enum {
-  GAME_STATE_MENU,
-  GAME_STATE_PLAYER_SELECT,
-  GAME_STATE_HELP,
-  GAME_STATE_PLAYING,
-  GAME_STATE_WIN
-} game_state_t;
-
-// Global menu state variables
-extern game_state_t game_state;
-extern int selected_players;
-extern int menu_selection;
-extern int winner;
-extern uint32_t win_timer;
-
 // Menu drawing functions
-void draw_menu(void);
-void draw_player_select(void);
+void draw_menu(const game_t *game);
+void draw_player_select(const game_t *game);
 void draw_help(void);
-void draw_win_screen(void);
+void draw_win_screen(const game_t *game);
+// Draws the screen of any state but GAME_STATE_PLAYING. The screens are
+// static, so they are drawn with SYSTEM_PRESERVE_FRAMEBUFFER set and only
+// repainted when what they show changes. Play clears the flag.
+void draw_menu_screen(const game_t *game);
 
 // Menu update functions
-void update_menu(void);
-void update_player_select(void);
-void update_help(void);
-void update_win(void);
+void update_menu(game_t *game, uint8_t pad);
+void update_player_select(game_t *game, uint8_t pad);
+void update_help(game_t *game, uint8_t pad);
+void update_win(game_t *game);
 
 // Menu initialization
-void init_menu_system(void);
+void init_menu_system(game_t *game);
 
 #endif
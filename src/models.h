@@ -7,6 +7,5 @@ extern model_t flag_model;
 extern model_t cube_model;
 extern model_t tank_model;
 extern model_t projectile_model;
-extern model_t explosion_model;
 
 #endif
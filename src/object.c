@@ -1,4 +1,5 @@
 #include "object.h"
+#include "yaw_cache.h"
 
 object_t create_object(model_t *model, float x, float y, float z, float rot_y,
                        float scale, float spawn_time, update_func_t func) {
@@ -37,17 +38,28 @@ void remove_object(object_t *objects, size_t obj_idx, size_t *obj_count) {
   (*obj_count)--;
 }
 
-void object_matrix(object_t *object, matrix44f_t *dest) {
-  static matrix44f_t translate;
-  static matrix44f_t rotate;
-  create_translation_matrix(object->pos.x, object->pos.y, object->pos.z,
-                            object->scale, &translate);
-  create_rotation_y_matrix(object->rot_y, &rotate);
-  mult_matrices(&rotate, &translate, dest);
+affine_t object_transform(const object_t *object) {
+  affine_t rotate = affine_rotation_y(object->rot_y);
+  affine_t scale_translate =
+      affine_scale_translation(object->scale, &object->pos);
+  affine_t transform;
+  affine_compose(&rotate, &scale_translate, &transform);
+  return transform;
 }
 
-void object_update(object_t *obj, size_t idx, float time) {
+void object_world_verts(object_t *object, const model_t *model,
+                        vec3f_t *dest) {
+  if (yaw_cache_transform(model, &object->pos, object->rot_y, object->scale,
+                          dest)) {
+    return;
+  }
+  affine_t transform = object_transform(object);
+  transform_model(model, &transform, dest);
+}
+
+void object_update(struct game_s *game, object_t *obj, size_t idx,
+                   float time) {
   if (obj->update != NULL) {
-    obj->update(obj, idx, time);
+    obj->update(game, obj, idx, time);
   }
 }
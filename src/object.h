@@ -5,8 +5,10 @@
 #include <stdint.h>
 
 typedef struct object_s object_t;
+struct game_s;
 
-typedef void (*update_func_t)(object_t *obj, size_t idx, float time);
+typedef void (*update_func_t)(struct game_s *game, object_t *obj, size_t idx,
+                              float time);
 
 struct object_s {
   model_t *model;
@@ -15,19 +17,26 @@ struct object_s {
   float scale;
   float spawn_time;
   update_func_t update;
+  // Last tick the simulation moved, turned or rescaled the object, so the
+  // renderer can keep what it computed for it since.
+  uint32_t changed_tick;
   uint8_t tag;
 };
 
-void handle_camera_movement(uint8_t gamepad, camera_t *camera);
-
 object_t *spawn_object(model_t *model, float x, float y, float z, float rot_y,
                        float scale, float spawn_time, update_func_t func,
                        object_t *objects, size_t *obj_idx,
                        const size_t obj_len);
 void remove_object(object_t *objects, size_t obj_idx, size_t *obj_count);
 
-void object_matrix(object_t *object, matrix44f_t *dest);
+// Model to world: yaw, then scale and translation.
+affine_t object_transform(const object_t *object);
+// Transforms the vertices of model (the object's model or one of its LODs)
+// to world space, from the yaw cache when it holds the model.
+void object_world_verts(object_t *object, const model_t *model,
+                        vec3f_t *dest);
 
-void object_update(object_t *obj, size_t idx, float time);
+void object_update(struct game_s *game, object_t *obj, size_t idx,
+                   float time);
 
 #endif
\ No newline at end of file
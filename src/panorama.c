@@ -0,0 +1,97 @@
+#include "panorama.h"
+#include "wasm4.h"
+
+#include <math.h>
+#include <string.h>
+
+// Tallest mountain in a full-screen view, the sum of the wave amplitudes.
+#define PANORAMA_HEIGHT 20
+
+// Strip level l serves views of SCREEN_SIZE >> l pixels: 2 * w columns for
+// 360 degrees, then the first w again, PANORAMA_HEIGHT >> l rows.
+#define STRIP_STRIDE(level) (3 * (SCREEN_SIZE >> (level)) / 4)
+#define STRIP_BYTES(level) (STRIP_STRIDE(level) * (PANORAMA_HEIGHT >> (level)))
+
+static uint8_t strip0[STRIP_BYTES(0)];
+static uint8_t strip1[STRIP_BYTES(1)];
+static uint8_t *const strips[PANORAMA_LEVELS] = {strip0, strip1};
+static uint32_t baked_seed;
+static int baked = 0;
+
+static void bake(int level, uint32_t seed) {
+  int width = SCREEN_SIZE >> level;
+  int rows = PANORAMA_HEIGHT >> level;
+  int stride = STRIP_STRIDE(level);
+  float height_scale = (float)width / SCREEN_SIZE;
+  float seed_offset1 = (seed & 0xFF) / 255.0f * M_PI * 2;
+  float seed_offset2 = ((seed >> 8) & 0xFF) / 255.0f * M_PI * 2;
+  float seed_offset3 = ((seed >> 16) & 0xFF) / 255.0f * M_PI * 2;
+  uint8_t *strip = strips[level];
+  memset(strip, 0, STRIP_BYTES(level));
+  for (int x = 0; x < 3 * width; x++) {
+    // A view spans pi radians across its width.
+    float world_angle = (x % (2 * width)) * (float)M_PI / width;
+    // Generate mountain height using multiple sine waves with random offsets
+    float height = 8 + 6 * sinf(world_angle * 3 + seed_offset1) +
+                   4 * sinf(world_angle * 7 + seed_offset2) +
+                   2 * sinf(world_angle * 13 + seed_offset3);
+    height *= height_scale;
+    if (height < 1)
+      height = 1;
+    // Draw color 3, framebuffer value 2, from the horizon up.
+    for (int y = rows - (int)height; y < rows; y++) {
+      strip[y * stride + x / 4] |= 2 << (x % 4 * 2);
+    }
+  }
+}
+
+void panorama_update(uint32_t seed) {
+  if (baked && seed == baked_seed) {
+    return;
+  }
+  for (int level = 0; level < PANORAMA_LEVELS; level++) {
+    bake(level, seed);
+  }
+  baked_seed = seed;
+  baked = 1;
+}
+
+void panorama_draw(const viewport_t *view, float yaw) {
+  int level = view->w == SCREEN_SIZE       ? 0
+              : view->w == SCREEN_SIZE / 2 ? 1
+                                           : -1;
+  if (level < 0 || view->h != view->w || view->x % 4 != 0) {
+    return;
+  }
+  int width = view->w;
+  int rows = PANORAMA_HEIGHT >> level;
+  int stride = STRIP_STRIDE(level);
+  int horizon = view->y + view->h / 2;
+
+  // The view's left edge looks pi / 2 left of the camera, and the world
+  // turns at a quarter of the camera's yaw.
+  float turn = -yaw / 4 * width / (float)M_PI;
+  int start = (int)floorf(turn + 0.5f) - width / 2;
+  start %= 2 * width;
+  if (start < 0) {
+    start += 2 * width;
+  }
+  const uint8_t *src = strips[level] + start / 4;
+  int shift = start % 4 * 2;
+  for (int y = 0; y < rows; y++) {
+    uint8_t *dest = target_row(horizon - rows + y) + view->x / 4;
+    if (shift == 0) {
+      memcpy(dest, src, width / 4);
+    } else {
+      for (int i = 0; i < width / 4; i++) {
+        dest[i] = (uint8_t)(src[i] >> shift | src[i + 1] << (8 - shift));
+      }
+    }
+    src += stride;
+  }
+
+  // Ground in draw color 2, framebuffer value 1.
+  for (int y = horizon; y < view->y + view->h; y++) {
+    memset(target_row(y) + view->x / 4, 0x55, width / 4);
+  }
+}
@@ -0,0 +1,22 @@
+#ifndef PANORAMA_H_INCLUDED
+#define PANORAMA_H_INCLUDED
+
+#include "draw.h"
+#include <stdint.h>
+
+// The mountain horizon depends only on the match's mountain seed and the
+// camera yaw, so the whole 360 degrees of it is baked once per seed into
+// packed 2bpp strips, one per view width, and views copy out the window
+// for their yaw. A view shows 180 degrees across its width, so a strip is
+// twice as wide as its view, plus a view's width repeated to save wrapping.
+#define PANORAMA_LEVELS 2 // Views of SCREEN_SIZE and SCREEN_SIZE / 2.
+
+// Rebakes the strips when the seed changed since the last call.
+void panorama_update(uint32_t seed);
+
+// Draws the mountains over the sky and the ground below the horizon of a
+// square view SCREEN_SIZE or SCREEN_SIZE / 2 wide whose x is a multiple of
+// 4, into the draw target. Other views get no background.
+void panorama_draw(const viewport_t *view, float yaw);
+
+#endif
@@ -0,0 +1,131 @@
+#include "particles.h"
+#include "draw.h"
+
+#define FLASH_TICKS 30
+#define DEBRIS_TICKS 40
+
+// Flash radius in 1/8 units: 4 + 20 * sin(pi * age / 30).
+static const uint8_t flash_radius[FLASH_TICKS] = {
+    32,  49,  65,  81,  97,  112, 126, 139, 151, 161,
+    171, 178, 184, 189, 191, 192, 191, 189, 184, 178,
+    171, 161, 151, 139, 126, 112, 97,  81,  65,  49};
+
+// Debris distance from the origin in 1/4 units, slowing down as it flies.
+static const uint8_t debris_spread[DEBRIS_TICKS] = {
+    0,  5,  9,  14, 18, 22, 27, 31, 35, 38, 42, 46, 49, 52,
+    55, 58, 61, 64, 67, 70, 72, 74, 77, 79, 81, 82, 84, 86,
+    87, 89, 90, 91, 92, 93, 94, 94, 95, 95, 96, 96};
+
+// Debris height above the origin in 1/4 units, a parabola.
+static const uint8_t debris_rise[DEBRIS_TICKS] = {
+    0,  8,  15, 22, 29, 35, 41, 46, 51, 56, 60, 64, 67, 70,
+    73, 75, 77, 78, 79, 80, 80, 80, 79, 78, 77, 75, 73, 70,
+    67, 64, 60, 56, 51, 46, 41, 35, 29, 22, 15, 8};
+
+// Directions of the debris ring on the ground plane, times 127.
+static const int8_t debris_dir[PARTICLE_DEBRIS_COUNT][2] = {
+    {110, 64}, {0, 127}, {-110, 64}, {-110, -64}, {0, -127}, {110, -64}};
+
+static void spawn(particles_t *particles, const vec3f_t *pos, uint8_t kind,
+                  uint8_t dir) {
+  if (particles->count >= PARTICLES_LEN) {
+    return;
+  }
+  uint8_t i = particles->count++;
+  particles->x[i] = pos->x;
+  particles->y[i] = pos->y;
+  particles->z[i] = pos->z;
+  particles->age[i] = 0;
+  particles->kind[i] = kind;
+  particles->dir[i] = dir;
+}
+
+void particles_clear(particles_t *particles) { particles->count = 0; }
+
+void particles_explode(particles_t *particles, const vec3f_t *pos) {
+  spawn(particles, pos, PARTICLE_FLASH, 0);
+  for (uint8_t i = 0; i < PARTICLE_DEBRIS_COUNT; i++) {
+    spawn(particles, pos, PARTICLE_DEBRIS, i);
+  }
+}
+
+void particles_update(particles_t *particles) {
+  size_t i = particles->count;
+  while (i-- > 0) {
+    uint8_t age = ++particles->age[i];
+    uint8_t life =
+        particles->kind[i] == PARTICLE_FLASH ? FLASH_TICKS : DEBRIS_TICKS;
+    if (age < life) {
+      continue;
+    }
+    // Swap in the last one; order doesn't matter as drawing sorts by depth.
+    uint8_t last = --particles->count;
+    particles->x[i] = particles->x[last];
+    particles->y[i] = particles->y[last];
+    particles->z[i] = particles->z[last];
+    particles->age[i] = particles->age[last];
+    particles->kind[i] = particles->kind[last];
+    particles->dir[i] = particles->dir[last];
+  }
+}
+
+void particles_world(const particles_t *particles, vec3f_t *dest) {
+  for (size_t i = 0; i < particles->count; i++) {
+    dest[i].x = particles->x[i];
+    dest[i].y = particles->y[i];
+    dest[i].z = particles->z[i];
+    if (particles->kind[i] == PARTICLE_DEBRIS) {
+      uint8_t age = particles->age[i];
+      float spread = debris_spread[age] * (0.25f / 127.f);
+      dest[i].x += debris_dir[particles->dir[i]][0] * spread;
+      dest[i].z += debris_dir[particles->dir[i]][1] * spread;
+      dest[i].y += debris_rise[age] * 0.25f;
+    }
+  }
+}
+
+void particles_buffer(const particles_t *particles, size_t first,
+                      size_t count, const vec3f_t *camera,
+                      const vec2i_t *raster, float pixels_per_unit,
+                      float far_plane, polygon_t *buffer, size_t *buf_idx,
+                      const size_t buf_len) {
+  for (size_t i = first; i < first + count && *buf_idx < buf_len; i++) {
+    float depth = camera[i].z;
+    if (depth > NEAR_PLANE || depth < -far_plane) {
+      continue;
+    }
+    uint8_t shape = SHAPE_POINT;
+    int radius = 0;
+    if (particles->kind[i] == PARTICLE_FLASH) {
+      float size = flash_radius[particles->age[i]] * 0.125f;
+      // Like the near plane drops triangles, a flash reaching past it (one
+      // going off on the viewer's own tank) isn't drawn.
+      if (depth + size > NEAR_PLANE) {
+        continue;
+      }
+      float pixels = size * pixels_per_unit / -depth;
+      // Same thresholds the explosion mesh used for its impostors.
+      if (pixels >= 4.f) {
+        shape = SHAPE_DIAMOND;
+        radius = (int)pixels;
+      } else if (pixels >= 1.5f) {
+        shape = SHAPE_SPRITE;
+      }
+    }
+    // Diamonds and sprites are drawn clipped and may poke into view.
+    int margin = shape == SHAPE_SPRITE ? 3 : radius;
+    vec2i_t p = raster[i];
+    viewport_t bounds = {p.x - margin, p.y - margin, 2 * margin + 1,
+                         2 * margin + 1};
+    if (!is_rect_visible(&bounds)) {
+      continue;
+    }
+    polygon_t *polygon = &buffer[(*buf_idx)++];
+    polygon->raster_verts[0] = p;
+    polygon->raster_verts[1].x = p.x + radius;
+    polygon->raster_verts[1].y = p.y;
+    polygon->depth = depth;
+    polygon->shape = shape;
+    polygon->shade = SHADE_PLAIN;
+  }
+}
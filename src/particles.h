@@ -0,0 +1,44 @@
+#ifndef PARTICLES_H_INCLUDED
+#define PARTICLES_H_INCLUDED
+
+#include "render.h"
+#include <stdint.h>
+
+// Explosion effects, kept out of the game object table so they never take a
+// slot from a tank or a shell. Each explosion is one flash and a ring of
+// debris, animated from precomputed curves by age alone. When the pool is
+// full, new particles are dropped.
+#define PARTICLES_LEN 32
+#define PARTICLE_DEBRIS_COUNT 6
+
+enum { PARTICLE_FLASH, PARTICLE_DEBRIS };
+
+// Structure of arrays; the first count entries are live.
+typedef struct {
+  float x[PARTICLES_LEN]; // Origin of the explosion.
+  float y[PARTICLES_LEN];
+  float z[PARTICLES_LEN];
+  uint8_t age[PARTICLES_LEN]; // Ticks since the explosion.
+  uint8_t kind[PARTICLES_LEN];
+  uint8_t dir[PARTICLES_LEN]; // Debris direction, an index into a ring.
+  uint8_t count;
+} particles_t;
+
+void particles_clear(particles_t *particles);
+void particles_explode(particles_t *particles, const vec3f_t *pos);
+// Ages every particle by a tick and drops the expired ones.
+void particles_update(particles_t *particles);
+
+// World-space position of every live particle, in order.
+void particles_world(const particles_t *particles, vec3f_t *dest);
+// Buffers a polygon per visible particle from first to first + count, from
+// the projected positions of all particles: debris as a pixel, flashes as a
+// diamond, the explosion sprite or a pixel depending on their size.
+// pixels_per_unit is the view's scale at a depth of 1.
+void particles_buffer(const particles_t *particles, size_t first,
+                      size_t count, const vec3f_t *camera,
+                      const vec2i_t *raster, float pixels_per_unit,
+                      float far_plane, polygon_t *buffer, size_t *buf_idx,
+                      const size_t buf_len);
+
+#endif
@@ -1,46 +1,71 @@
 #include "render.h"
+#include "arena.h"
 #include "draw.h"
-
-#define SCREEN_SIZE 160
+#include "simd.h"
+#include "wasm4.h"
 
 #include <math.h>
-
-void mult_vec_matrix(const vec3f_t *src, vec3f_t *dst, const matrix44f_t *mat) {
-  float a = src->x * mat->m[0][0] + src->y * mat->m[1][0] +
-            src->z * mat->m[2][0] + mat->m[3][0];
-  float b = src->x * mat->m[0][1] + src->y * mat->m[1][1] +
-            src->z * mat->m[2][1] + mat->m[3][1];
-  float c = src->x * mat->m[0][2] + src->y * mat->m[1][2] +
-            src->z * mat->m[2][2] + mat->m[3][2];
-  float w = src->x * mat->m[0][3] + src->y * mat->m[1][3] +
-            src->z * mat->m[2][3] + mat->m[3][3];
-
-  dst->x = a / w;
-  dst->y = b / w;
-  dst->z = c / w;
+#include <string.h>
+
+void affine_apply(const affine_t *a, const vec3f_t *src, vec3f_t *dst) {
+  float x = src->x * a->m[0][0] + src->y * a->m[1][0] + src->z * a->m[2][0] +
+            a->t.x;
+  float y = src->x * a->m[0][1] + src->y * a->m[1][1] + src->z * a->m[2][1] +
+            a->t.y;
+  float z = src->x * a->m[0][2] + src->y * a->m[1][2] + src->z * a->m[2][2] +
+            a->t.z;
+  dst->x = x;
+  dst->y = y;
+  dst->z = z;
 }
 
-vec3f_t project_vertex(const vec3f_t *world, vec2i_t *raster,
-                       const matrix44f_t *world_to_camera, float canvas_width,
-                       float canvas_height, float image_width,
-                       float image_height) {
-  vec3f_t camera;
-  mult_vec_matrix(world, &camera, world_to_camera);
+void affine_compose(const affine_t *a, const affine_t *b, affine_t *dst) {
+  affine_t r;
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      r.m[i][j] = a->m[i][0] * b->m[0][j] + a->m[i][1] * b->m[1][j] +
+                  a->m[i][2] * b->m[2][j];
+    }
+  }
+  affine_apply(b, &a->t, &r.t);
+  *dst = r;
+}
 
-  vec2f_t screen;
-  screen.x = camera.x / -camera.z;
-  screen.y = camera.y / -camera.z;
+affine_t affine_inverse(const affine_t *a) {
+  // m is a rotation times a uniform scale s, so its inverse is its
+  // transpose divided by s squared.
+  float s2 = a->m[0][0] * a->m[0][0] + a->m[0][1] * a->m[0][1] +
+             a->m[0][2] * a->m[0][2];
+  affine_t r;
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      r.m[i][j] = a->m[j][i] / s2;
+    }
+  }
+  vec3f_t t = {-a->t.x, -a->t.y, -a->t.z};
+  vec3f_t zero = {0, 0, 0};
+  r.t = zero;
+  affine_apply(&r, &t, &r.t);
+  return r;
+}
 
-  vec2f_t ndc;
-  ndc.x = (screen.x + canvas_width * 0.5f) / canvas_width;
-  ndc.y = (screen.y + canvas_height * 0.5f) / canvas_height;
+affine_t affine_rotation_y(float angle) {
+  float c = cosf(angle);
+  float s = sinf(angle);
+  affine_t r = {.m = {{c, 0.0f, -s}, {0.0f, 1.0f, 0.0f}, {s, 0.0f, c}},
+                .t = {0.0f, 0.0f, 0.0f}};
+  return r;
+}
 
-  raster->x = (int)(ndc.x * image_width);
-  raster->y = (int)((1.0f - ndc.y) * image_height);
-  return camera;
+affine_t affine_scale_translation(float scale, const vec3f_t *pos) {
+  affine_t r = {.m = {{scale, 0.0f, 0.0f},
+                      {0.0f, scale, 0.0f},
+                      {0.0f, 0.0f, scale}},
+                .t = *pos};
+  return r;
 }
 
-matrix44f_t build_camera_matrix(camera_t *camera) {
+affine_t build_camera_transform(const camera_t *camera) {
   float cos_yaw = cosf(camera->yaw);
   float sin_yaw = sinf(camera->yaw);
   float cos_pitch = cosf(camera->pitch);
@@ -55,183 +80,235 @@ matrix44f_t build_camera_matrix(camera_t *camera) {
   // Up is perpendicular to both forward and right
   vec3f_t up = {cos_yaw * sin_pitch, cos_pitch, sin_yaw * sin_pitch};
 
-  matrix44f_t matrix = {
-      .m = {{right.x, up.x, -forward.x, 0},
-            {right.y, up.y, -forward.y, 0},
-            {right.z, up.z, -forward.z, 0},
-            {camera->pos.x, camera->pos.y, camera->pos.z, 1}}};
+  affine_t transform = {.m = {{right.x, up.x, -forward.x},
+                               {right.y, up.y, -forward.y},
+                               {right.z, up.z, -forward.z}},
+                         .t = camera->pos};
 
-  return matrix;
+  return transform;
 }
 
-matrix44f_t inverse_matrix44f(const matrix44f_t *mat) {
-  matrix44f_t result = {{{0}}};
-  matrix44f_t t = *mat;
-  matrix44f_t s = {
-      .m = {{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}}};
-  int i, j, k;
-
-  for (i = 0; i < 3; i++) {
-    int pivot = i;
-    float pivotsize = (float)fabs(t.m[i][i]);
-    for (j = i + 1; j < 4; j++) {
-      float tmp = (float)fabs(t.m[j][i]);
-      if (tmp > pivotsize) {
-        pivot = j;
-        pivotsize = tmp;
-      }
-    }
-
-    if (pivotsize == 0)
-      return result;
-
-    if (pivot != i) {
-      for (j = 0; j < 4; j++) {
-        float tmp = t.m[i][j];
-        t.m[i][j] = t.m[pivot][j];
-        t.m[pivot][j] = tmp;
+void transform_model(const model_t *model, const affine_t *transform,
+                     vec3f_t *dest) {
+  float scale = model->vert_scale;
+  for (size_t i = 0; i < model->verts_count; i++) {
+    vec3f_t v = {model->verts[i].x * scale, model->verts[i].y * scale,
+                 model->verts[i].z * scale};
+    affine_apply(transform, &v, &dest[i]);
+  }
+}
 
-        tmp = s.m[i][j];
-        s.m[i][j] = s.m[pivot][j];
-        s.m[pivot][j] = tmp;
-      }
+void project_vertices(const vec3f_t *world, size_t count,
+                      const affine_t *world_to_camera,
+                      const viewport_t *viewport, vec3f_t *camera,
+                      vec2i_t *raster) {
+  const affine_t *a = world_to_camera;
+  const f32x4_t m00 = f32x4_splat(a->m[0][0]), m01 = f32x4_splat(a->m[0][1]),
+                m02 = f32x4_splat(a->m[0][2]), m10 = f32x4_splat(a->m[1][0]),
+                m11 = f32x4_splat(a->m[1][1]), m12 = f32x4_splat(a->m[1][2]),
+                m20 = f32x4_splat(a->m[2][0]), m21 = f32x4_splat(a->m[2][1]),
+                m22 = f32x4_splat(a->m[2][2]);
+  const f32x4_t tx = f32x4_splat(a->t.x), ty = f32x4_splat(a->t.y),
+                tz = f32x4_splat(a->t.z);
+  const f32x4_t zero = f32x4_splat(0.0f), one = f32x4_splat(1.0f),
+                half = f32x4_splat(0.5f), near = f32x4_splat(NEAR_PLANE);
+  const f32x4_t width = f32x4_splat((float)viewport->w),
+                height = f32x4_splat((float)viewport->h);
+  const i32x4_t left = i32x4_splat(viewport->x), top = i32x4_splat(viewport->y);
+
+  // Four vertices at a time, as structure of arrays. The operations run in
+  // the same order as affine_apply() so that every backend, vectorized or
+  // not, gives the same pixels.
+  for (size_t i = 0; i < count; i += 4) {
+    size_t n = count - i < 4 ? count - i : 4;
+    float x[4], y[4], z[4];
+    for (size_t j = 0; j < 4; j++) {
+      // A short last batch repeats its last vertex.
+      const vec3f_t *v = &world[i + (j < n ? j : n - 1)];
+      x[j] = v->x;
+      y[j] = v->y;
+      z[j] = v->z;
     }
-
-    for (j = i + 1; j < 4; j++) {
-      float f = t.m[j][i] / t.m[i][i];
-      for (k = 0; k < 4; k++) {
-        t.m[j][k] -= f * t.m[i][k];
-        s.m[j][k] -= f * s.m[i][k];
-      }
+    f32x4_t wx = f32x4_load(x), wy = f32x4_load(y), wz = f32x4_load(z);
+    f32x4_t cx = f32x4_add(
+        f32x4_add(f32x4_add(f32x4_mul(wx, m00), f32x4_mul(wy, m10)),
+                  f32x4_mul(wz, m20)),
+        tx);
+    f32x4_t cy = f32x4_add(
+        f32x4_add(f32x4_add(f32x4_mul(wx, m01), f32x4_mul(wy, m11)),
+                  f32x4_mul(wz, m21)),
+        ty);
+    f32x4_t cz = f32x4_add(
+        f32x4_add(f32x4_add(f32x4_mul(wx, m02), f32x4_mul(wy, m12)),
+                  f32x4_mul(wz, m22)),
+        tz);
+
+    // Vertices in front of the near plane get raster 0,0; any triangle
+    // using them is dropped. Their lanes may divide by a tiny depth, which
+    // is harmless as the result is discarded.
+    f32x4_t depth = f32x4_sub(zero, cz);
+    f32x4_t ndc_x = f32x4_mul(f32x4_add(f32x4_div(cx, depth), one), half);
+    f32x4_t ndc_y = f32x4_mul(f32x4_add(f32x4_div(cy, depth), one), half);
+    i32x4_t clip = f32x4_gt(cz, near);
+    i32x4_t rx = i32x4_clear(
+        i32x4_add(i32x4_trunc(f32x4_mul(ndc_x, width)), left), clip);
+    i32x4_t ry = i32x4_clear(
+        i32x4_add(i32x4_trunc(f32x4_mul(f32x4_sub(one, ndc_y), height)), top),
+        clip);
+
+    int32_t out_x[4], out_y[4];
+    f32x4_store(x, cx);
+    f32x4_store(y, cy);
+    f32x4_store(z, cz);
+    i32x4_store(out_x, rx);
+    i32x4_store(out_y, ry);
+    for (size_t j = 0; j < n; j++) {
+      camera[i + j].x = x[j];
+      camera[i + j].y = y[j];
+      camera[i + j].z = z[j];
+      raster[i + j].x = out_x[j];
+      raster[i + j].y = out_y[j];
     }
   }
+}
+
+const model_t *select_lod(const model_t *model, float projected_radius) {
+  while (model != NULL && projected_radius < model->lod_radius) {
+    model = model->lod;
+  }
+  return model;
+}
 
-  for (i = 3; i >= 0; --i) {
-    float f = t.m[i][i];
-    if (f == 0)
-      return result;
+size_t model_polygons(const model_t *model) {
+  return model->shape == SHAPE_TRIANGLES ? model->tris_count : 1;
+}
 
-    for (j = 0; j < 4; j++) {
-      t.m[i][j] /= f;
-      s.m[i][j] /= f;
-    }
+static int compare_budget_items(const void *a, const void *b) {
+  float p1 = ((const budget_item_t *)a)->priority;
+  float p2 = ((const budget_item_t *)b)->priority;
+  return (p1 < p2) - (p1 > p2);
+}
 
-    for (j = 0; j < i; j++) {
-      f = t.m[j][i];
-      for (k = 0; k < 4; k++) {
-        t.m[j][k] -= f * t.m[i][k];
-        s.m[j][k] -= f * s.m[i][k];
-      }
+size_t fit_polygon_budget(budget_item_t *items, size_t count, size_t budget,
+                          budget_report_t *report) {
+  qsort(items, count, sizeof(budget_item_t), compare_budget_items);
+  size_t used = 0;
+  for (size_t i = 0; i < count; i++) {
+    const model_t *model = items[i].model;
+    while (model != NULL && used + model_polygons(model) > budget) {
+      model = model->lod;
+    }
+    if (model == NULL) {
+      report->dropped++;
+    } else {
+      report->degraded += model != items[i].model;
+      used += model_polygons(model);
     }
+    items[i].model = model;
   }
-  return s;
+  return used;
 }
 
-int is_behind_camera(const vec3f_t *v0, const vec3f_t *v1, const vec3f_t *v2,
-                     const matrix44f_t *world_to_camera) {
-  // Transform vertices to camera space
-  vec3f_t c0, c1, c2;
-  mult_vec_matrix(v0, &c0, world_to_camera);
-  mult_vec_matrix(v1, &c1, world_to_camera);
-  mult_vec_matrix(v2, &c2, world_to_camera);
-
-  const float near_threshold = -1.f;
-  return c0.z > near_threshold || c1.z > near_threshold ||
-         c2.z > near_threshold;
+// Faces wind counter-clockwise seen from outside. With the camera basis of
+// build_camera_transform(), that leaves front faces with a positive cross
+// product in raster coordinates. Edge-on faces count as back facing.
+static int is_back_facing(const vec2i_t *r0, const vec2i_t *r1,
+                          const vec2i_t *r2) {
+  int cross = (r1->x - r0->x) * (r2->y - r0->y) -
+              (r1->y - r0->y) * (r2->x - r0->x);
+  return cross <= 0;
 }
 
-void create_translation_matrix(float x, float y, float z, float scale,
-                               matrix44f_t *dest) {
-  dest->m[0][0] = scale;
-  dest->m[0][1] = 0.0f;
-  dest->m[0][2] = 0.0f;
-  dest->m[0][3] = 0.0f;
-
-  dest->m[1][0] = 0.0f;
-  dest->m[1][1] = scale;
-  dest->m[1][2] = 0.0f;
-  dest->m[1][3] = 0.0f;
-
-  dest->m[2][0] = 0.0f;
-  dest->m[2][1] = 0.0f;
-  dest->m[2][2] = scale;
-  dest->m[2][3] = 0.0f;
-
-  dest->m[3][0] = x;
-  dest->m[3][1] = y;
-  dest->m[3][2] = z;
-  dest->m[3][3] = 1.0f;
+// Buffers a point, line or sprite impostor as one polygon at the depth of
+// its vertices.
+static void buffer_impostor(const model_t *model, const vec3f_t *camera,
+                            const vec2i_t *raster, float far_plane,
+                            polygon_t *buffer, size_t *buf_idx,
+                            const size_t buf_len) {
+  size_t count = model->shape == SHAPE_LINE ? 2 : 1;
+  if (*buf_idx >= buf_len || model->verts_count < count) {
+    return;
+  }
+  float depth = 0.0f;
+  int visible = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (camera[i].z > NEAR_PLANE || camera[i].z < -far_plane) {
+      return;
+    }
+    depth += camera[i].z;
+    visible |= is_point_visible(&raster[i]);
+  }
+  // Sprites are drawn clipped, so one partly on screen still counts.
+  if (!visible && model->shape != SHAPE_SPRITE) {
+    return;
+  }
+  polygon_t *polygon = &buffer[*buf_idx];
+  polygon->raster_verts[0] = raster[0];
+  polygon->raster_verts[1] = raster[count - 1];
+  polygon->depth = depth / count;
+  polygon->shape = model->shape;
+  polygon->shade = SHADE_PLAIN;
+  (*buf_idx)++;
 }
 
-void create_rotation_y_matrix(float angle, matrix44f_t *dest) {
-  float c = cosf(angle);
-  float s = sinf(angle);
-  dest->m[0][0] = c;
-  dest->m[0][1] = 0.0f;
-  dest->m[0][2] = -s;
-  dest->m[0][3] = 0.0f;
-
-  dest->m[1][0] = 0.0f;
-  dest->m[1][1] = 1.0f;
-  dest->m[1][2] = 0.0f;
-  dest->m[1][3] = 0.0f;
-
-  dest->m[2][0] = s;
-  dest->m[2][1] = 0.0f;
-  dest->m[2][2] = c;
-  dest->m[2][3] = 0.0f;
-
-  dest->m[3][0] = 0.0f;
-  dest->m[3][1] = 0.0f;
-  dest->m[3][2] = 0.0f;
-  dest->m[3][3] = 1.0f;
+vec3f_t model_light(float rot_y) {
+  // The inverse turn, p * rotation(-rot_y), as the light is a row vector.
+  affine_t turn = affine_rotation_y(-rot_y);
+  vec3f_t light = {LIGHT_X, LIGHT_Y, LIGHT_Z};
+  vec3f_t dest;
+  affine_apply(&turn, &light, &dest);
+  return dest;
 }
 
-// Multiply two matrices
-void mult_matrices(const matrix44f_t *a, const matrix44f_t *b,
-                   matrix44f_t *result) {
-  for (int i = 0; i < 4; i++) {
-    for (int j = 0; j < 4; j++) {
-      result->m[i][j] = 0;
-      for (int k = 0; k < 4; k++) {
-        result->m[i][j] += a->m[i][k] * b->m[k][j];
-      }
-    }
-  }
+// Faces turned towards the light by more than about 60 degrees are lit and
+// those turned away by more than 95 are in shadow, in normal units of 1/127.
+#define LIT_DOT 64.f
+#define SHADOW_DOT -10.f
+
+static uint8_t face_shade(const vec3q_t *normal, const vec3f_t *light) {
+  float dot = normal->x * light->x + normal->y * light->y +
+              normal->z * light->z;
+  return dot > LIT_DOT ? SHADE_LIT : dot < SHADOW_DOT ? SHADE_SHADOW
+                                                      : SHADE_PLAIN;
 }
 
-void buffer_model(model_t *model, matrix44f_t *transform,
-                  matrix44f_t *world_to_camera, polygon_t *buffer,
-                  size_t *buf_idx, const size_t buf_len) {
+void buffer_model(const model_t *model, const vec3f_t *light,
+                  const vec3f_t *camera, const vec2i_t *raster,
+                  float far_plane, polygon_t *buffer, size_t *buf_idx,
+                  const size_t buf_len) {
+  if (model->shape != SHAPE_TRIANGLES) {
+    buffer_impostor(model, camera, raster, far_plane, buffer, buf_idx,
+                    buf_len);
+    return;
+  }
   for (size_t i = 0; i < model->tris_count && *buf_idx < buf_len; ++i) {
-    vec3f_t v0 = model->verts[model->tris[i * 3]];
-    vec3f_t v1 = model->verts[model->tris[i * 3 + 1]];
-    vec3f_t v2 = model->verts[model->tris[i * 3 + 2]];
+    uint8_t i0 = model->tris[i * 3];
+    uint8_t i1 = model->tris[i * 3 + 1];
+    uint8_t i2 = model->tris[i * 3 + 2];
 
-    mult_vec_matrix(&v0, &v0, transform);
-    mult_vec_matrix(&v1, &v1, transform);
-    mult_vec_matrix(&v2, &v2, transform);
-
-    if (is_behind_camera(&v0, &v1, &v2, world_to_camera)) {
+    if (camera[i0].z > NEAR_PLANE || camera[i1].z > NEAR_PLANE ||
+        camera[i2].z > NEAR_PLANE) {
       continue;
     }
-
-    vec2i_t r0, r1, r2;
-    vec3f_t c0, c1, c2;
-    c0 = project_vertex(&v0, &r0, world_to_camera, 2.0f, 2.0f, SCREEN_SIZE,
-                        SCREEN_SIZE);
-    c1 = project_vertex(&v1, &r1, world_to_camera, 2.0f, 2.0f, SCREEN_SIZE,
-                        SCREEN_SIZE);
-    c2 = project_vertex(&v2, &r2, world_to_camera, 2.0f, 2.0f, SCREEN_SIZE,
-                        SCREEN_SIZE);
-    // Skip triangles completely outside the screen
-    if (!is_triangle_visible(&r0, &r1, &r2)) {
+    if (camera[i0].z < -far_plane && camera[i1].z < -far_plane &&
+        camera[i2].z < -far_plane) {
       continue;
     }
-    buffer[*buf_idx].raster_verts[0] = r0;
-    buffer[*buf_idx].raster_verts[1] = r1;
-    buffer[*buf_idx].raster_verts[2] = r2;
-    buffer[*buf_idx].depth = (c0.z + c1.z + c2.z) / 3.0f;
+    // Skip triangles completely outside the viewport
+    if (!is_triangle_visible(&raster[i0], &raster[i1], &raster[i2])) {
+      continue;
+    }
+    if ((model->flags & MODEL_CLOSED) &&
+        is_back_facing(&raster[i0], &raster[i1], &raster[i2])) {
+      continue;
+    }
+    buffer[*buf_idx].raster_verts[0] = raster[i0];
+    buffer[*buf_idx].raster_verts[1] = raster[i1];
+    buffer[*buf_idx].raster_verts[2] = raster[i2];
+    buffer[*buf_idx].depth =
+        (camera[i0].z + camera[i1].z + camera[i2].z) / 3.0f;
+    buffer[*buf_idx].shape = SHAPE_TRIANGLES;
+    buffer[*buf_idx].shade = face_shade(&model->normals[i], light);
     (*buf_idx)++;
   }
 }
@@ -247,16 +324,199 @@ int compare_triangles(const void *a, const void *b) {
   return 0;
 }
 
-void render_buffer(polygon_t *buffer, size_t buf_len) {
+// 7x7 burst drawn for far away explosions, one byte per row, MSB leftmost.
+static const uint8_t explosion_sprite[7] = {0x10, 0x54, 0x38, 0xfe,
+                                            0x38, 0x54, 0x10};
+
+void sort_polygons(polygon_t *buffer, size_t buf_len) {
   qsort(buffer, buf_len, sizeof(polygon_t), compare_triangles);
-  for (size_t i = 0; i < buf_len; i++) {
-    polygon_t *polygon = &buffer[i];
-    vec2i_t r0, r1, r2;
-    r0 = polygon->raster_verts[0];
-    r1 = polygon->raster_verts[1];
-    r2 = polygon->raster_verts[2];
+}
+
+// Framebuffer bytes of each shade for even and odd rows, checkerboards of
+// framebuffer values 1 and 2 and of 2 and 3.
+static const uint8_t shade_fill[][2] = {
+    [SHADE_LIT] = {0x99, 0x66},
+    [SHADE_PLAIN] = {0xaa, 0xaa},
+    [SHADE_SHADOW] = {0xee, 0xbb},
+};
+
+static void draw_polygon(const polygon_t *polygon) {
+  set_fill(shade_fill[polygon->shade][0], shade_fill[polygon->shade][1]);
+  vec2i_t r0, r1, r2;
+  r0 = polygon->raster_verts[0];
+  r1 = polygon->raster_verts[1];
+  r2 = polygon->raster_verts[2];
+  switch (polygon->shape) {
+  case SHAPE_TRIANGLES:
     tri(r0.x, r0.y, r1.x, r1.y, r2.x, r2.y);
+    break;
+  case SHAPE_POINT:
+  case SHAPE_LINE:
+    bline(r0.x, r0.y, r1.x, r1.y);
+    break;
+  case SHAPE_SPRITE:
+    sprite(explosion_sprite, 7, r0.x - 3, r0.y - 3);
+    break;
+  case SHAPE_DIAMOND:
+    diamond(r0.x, r0.y, r1.x - r0.x);
+    break;
+  }
+}
+
+// With a band runner, polygons are binned into bands of whole rows of the
+// draw target and each band is drawn clipped to its rows. Bands never share
+// a byte, so the runner may draw them concurrently. Without one there is
+// nothing to gain from bands, as every band a polygon crosses sets it up
+// again, so the list is drawn in one pass.
+#define BAND_ROWS 16
+#define BAND_COUNT ((SCREEN_SIZE + BAND_ROWS - 1) / BAND_ROWS)
+
+typedef struct {
+  const polygon_t *buffer;
+  const uint16_t *bins; // Polygon indices, band by band, in buffer order.
+  uint16_t start[BAND_COUNT + 1];
+  viewport_t clip;
+  coverage_row_t *rows; // Coverage for clip when drawing front to back.
+} bands_t;
+
+static band_runner_t band_runner = NULL;
+
+void set_band_runner(band_runner_t runner) { band_runner = runner; }
+
+// Rows a polygon can touch, outline included.
+static void polygon_rows(const polygon_t *polygon, int *top, int *bottom) {
+  const vec2i_t *r = polygon->raster_verts;
+  int y0 = r[0].y;
+  int y1 = r[0].y;
+  switch (polygon->shape) {
+  case SHAPE_TRIANGLES:
+    for (int i = 1; i < 3; i++) {
+      y0 = r[i].y < y0 ? r[i].y : y0;
+      y1 = r[i].y > y1 ? r[i].y : y1;
+    }
+    break;
+  case SHAPE_POINT:
+  case SHAPE_LINE:
+    y0 = r[1].y < y0 ? r[1].y : y0;
+    y1 = r[1].y > y1 ? r[1].y : y1;
+    break;
+  case SHAPE_SPRITE:
+    y0 -= 3;
+    y1 += 3;
+    break;
+  case SHAPE_DIAMOND:
+    y0 -= r[1].x - r[0].x;
+    y1 += r[1].x - r[0].x;
+    break;
+  }
+  *top = y0;
+  *bottom = y1;
+}
+
+static void draw_band(void *ctx, size_t band) {
+  const bands_t *bands = (const bands_t *)ctx;
+  viewport_t clip = bands->clip;
+  int y0 = (int)band * BAND_ROWS;
+  int y1 = y0 + BAND_ROWS;
+  y0 = y0 < clip.y ? clip.y : y0;
+  y1 = y1 > clip.y + clip.h ? clip.y + clip.h : y1;
+  if (y0 >= y1) {
+    return;
+  }
+  viewport_t band_clip = {clip.x, y0, clip.w, y1 - y0};
+  set_clip(&band_clip);
+  if (bands->rows != NULL) {
+    coverage_row_t *rows = &bands->rows[y0 - clip.y];
+    memset(rows, 0, (y1 - y0) * sizeof(coverage_row_t));
+    set_coverage(rows);
+    // Nearest first.
+    size_t i = bands->start[band + 1];
+    while (i-- > bands->start[band]) {
+      draw_polygon(&bands->buffer[bands->bins[i]]);
+    }
+    set_coverage(NULL);
+  } else {
+    for (size_t i = bands->start[band]; i < bands->start[band + 1]; i++) {
+      draw_polygon(&bands->buffer[bands->bins[i]]);
+    }
+  }
+  set_clip(&clip);
+}
+
+static void draw_unbinned(const polygon_t *buffer, size_t buf_len,
+                          coverage_row_t *rows, int row_count) {
+  if (rows == NULL) {
+    for (size_t i = 0; i < buf_len; i++) {
+      draw_polygon(&buffer[i]);
+    }
+    return;
+  }
+  memset(rows, 0, row_count * sizeof(coverage_row_t));
+  set_coverage(rows);
+  size_t i = buf_len;
+  while (i-- > 0) {
+    draw_polygon(&buffer[i]);
+  }
+  set_coverage(NULL);
+}
+
+static void render_bands(const polygon_t *buffer, size_t buf_len,
+                         coverage_row_t *rows, int row_count) {
+  if (band_runner == NULL) {
+    draw_unbinned(buffer, buf_len, rows, row_count);
+    return;
+  }
+  size_t mark = arena_mark(&frame_arena);
+  bands_t bands = {.buffer = buffer, .clip = get_clip(), .rows = rows};
+  int first = bands.clip.y / BAND_ROWS;
+  int last = (bands.clip.y + bands.clip.h - 1) / BAND_ROWS;
+
+  // Count the polygons of each band, then place them.
+  uint16_t count[BAND_COUNT] = {0};
+  for (size_t i = 0; i < buf_len; i++) {
+    int top, bottom;
+    polygon_rows(&buffer[i], &top, &bottom);
+    for (int b = first; b <= last; b++) {
+      count[b] += top < (b + 1) * BAND_ROWS && bottom >= b * BAND_ROWS;
+    }
+  }
+  bands.start[0] = 0;
+  for (int b = 0; b < BAND_COUNT; b++) {
+    bands.start[b + 1] = bands.start[b] + count[b];
+  }
+  uint16_t *bins =
+      arena_alloc(&frame_arena, bands.start[BAND_COUNT] * sizeof(uint16_t));
+  if (bins == NULL) {
+    // Out of scratch: draw as one band.
+    arena_release(&frame_arena, mark);
+    draw_unbinned(buffer, buf_len, rows, row_count);
+    return;
   }
+  for (int b = 0; b < BAND_COUNT; b++) {
+    count[b] = bands.start[b];
+  }
+  for (size_t i = 0; i < buf_len; i++) {
+    int top, bottom;
+    polygon_rows(&buffer[i], &top, &bottom);
+    for (int b = first; b <= last; b++) {
+      if (top < (b + 1) * BAND_ROWS && bottom >= b * BAND_ROWS) {
+        bins[count[b]++] = (uint16_t)i;
+      }
+    }
+  }
+  bands.bins = bins;
+
+  band_runner(draw_band, &bands, BAND_COUNT);
+  arena_release(&frame_arena, mark);
+}
+
+void render_buffer(const polygon_t *buffer, size_t buf_len) {
+  render_bands(buffer, buf_len, NULL, 0);
+}
+
+void render_buffer_front_to_back(const polygon_t *buffer, size_t buf_len,
+                                 coverage_row_t *rows, int row_count) {
+  render_bands(buffer, buf_len, rows, row_count);
 }
 
 float vec3f_xz_distance(const vec3f_t v1, const vec3f_t v2) {
@@ -7,19 +7,91 @@ typedef struct {
   float x, y, z;
 } vec3f_t;
 
+// Affine transform of row vectors, p' = p * m + t. Objects and cameras only
+// rotate, scale uniformly and translate, so m is always a rotation times a
+// uniform scale, which gives a closed-form inverse.
 typedef struct {
-  float m[4][4];
-} matrix44f_t;
+  float m[3][3];
+  vec3f_t t;
+} affine_t;
 
+// Camera-space depth in front of which triangles are dropped.
+#define NEAR_PLANE -1.f
+// Distance beyond which objects and triangles are dropped.
+#ifndef FAR_PLANE
+#define FAR_PLANE 600.f
+#endif
+
+// Model vertex in fixed point, decoded by scaling with the model's
+// vert_scale.
 typedef struct {
-  const uint32_t *tris;
-  const vec3f_t *verts;
-  const size_t tris_count;
+  int8_t x, y, z;
+} vec3q_t;
+
+// What a model or a buffered polygon draws as. The impostor shapes stand in
+// for models too small on screen to be worth their triangles: they are
+// drawn from the first one or two projected vertices of the model.
+enum {
+  SHAPE_TRIANGLES,
+  SHAPE_POINT,  // One pixel at vertex 0.
+  SHAPE_LINE,   // A line from vertex 0 to vertex 1.
+  SHAPE_SPRITE, // The explosion sprite centered on vertex 0.
+  SHAPE_DIAMOND, // Filled diamond around vertex 0 reaching out to vertex 1.
+};
+
+// Model flags, set by the model compiler.
+#define MODEL_CLOSED 1 // Watertight, so faces seen from behind are culled.
+#define MODEL_CONVEX 2 // Front faces never overlap and need no sorting.
+
+// How a view orders what it draws, set with -DRENDER_ORDER (make ORDER=...).
+// ORDER_TRIANGLES sorts every polygon of the view by depth. ORDER_OBJECTS
+// sorts objects and particles by depth, then only the triangles within each
+// model that isn't convex. ORDER_SPANS orders like ORDER_OBJECTS but draws
+// front to back over a coverage buffer, writing each pixel once.
+#define ORDER_TRIANGLES 0
+#define ORDER_OBJECTS 1
+#define ORDER_SPANS 2
+#ifndef RENDER_ORDER
+#define RENDER_ORDER ORDER_OBJECTS
+#endif
+
+// Models are packed: 8-bit vertex indices (at most 256 vertices) and 8-bit
+// fixed-point coordinates, a quarter of the size of floats and 32-bit
+// indices. The tables are generated from models/*.obj by host/modelc.c.
+typedef struct model_s {
+  const uint8_t *tris;
+  const vec3q_t *verts;
+  const vec3q_t *normals; // Per triangle, unit length times 127.
+  const uint8_t tris_count;
+  const uint8_t verts_count;
+  const float vert_scale; // Model units per coordinate step.
+  const float radius;     // Bounding sphere around the model origin.
+  const uint8_t flags;    // MODEL_CLOSED, MODEL_CONVEX.
+  // Level of detail: below lod_radius pixels of projected radius the model
+  // is drawn as lod instead, or not at all when lod is NULL.
+  const struct model_s *lod;
+  const float lod_radius;
+  const uint8_t shape; // SHAPE_TRIANGLES, or the kind of impostor.
 } model_t;
 
+// Fill of a polygon, from how squarely its face meets the light.
+enum {
+  SHADE_LIT,    // Dithered draw colors 2 and 3.
+  SHADE_PLAIN,  // Draw color 3; impostors and faces at an angle.
+  SHADE_SHADOW, // Dithered draw colors 3 and 4.
+};
+
+// Direction towards the light in world space, unit length. Objects only
+// turn about Y, so it is cheap to take into model space once per object.
+#define LIGHT_X 0.48f
+#define LIGHT_Y 0.8f
+#define LIGHT_Z 0.36f
+
 typedef struct {
   vec2i_t raster_verts[3]; // Vertices in screen space
   float depth;             // Average Z depth in camera space
+  uint8_t shape;           // SHAPE_TRIANGLES for a triangle, else impostor
+  uint8_t shade;           // SHADE_*
 } polygon_t;
 
 typedef struct {
@@ -28,26 +100,78 @@ typedef struct {
   float pitch;
   float movement_speed;
   float rotation_speed;
+  uint32_t changed_tick; // Last tick the camera moved or turned.
 } camera_t;
 
-void mult_vec_matrix(const vec3f_t *src, vec3f_t *dst, const matrix44f_t *mat);
-vec3f_t project_vertex(const vec3f_t *world, vec2i_t *raster,
-                       const matrix44f_t *world_to_camera, float canvas_width,
-                       float canvas_height, float image_width,
-                       float image_height);
-matrix44f_t build_camera_matrix(camera_t *camera);
-matrix44f_t inverse_matrix44f(const matrix44f_t *mat);
-int is_behind_camera(const vec3f_t *v0, const vec3f_t *v1, const vec3f_t *v2,
-                     const matrix44f_t *world_to_camera);
-void mult_matrices(const matrix44f_t *a, const matrix44f_t *b,
-                   matrix44f_t *result);
-void create_translation_matrix(float x, float y, float z, float scale,
-                               matrix44f_t *dest);
-void create_rotation_y_matrix(float angle, matrix44f_t *dest);
-void buffer_model(model_t *model, matrix44f_t *transform,
-                  matrix44f_t *world_to_camera, polygon_t *buffer,
-                  size_t *buf_idx, const size_t buf_len);
-void render_buffer(polygon_t *buffer, size_t buf_len);
+void affine_apply(const affine_t *a, const vec3f_t *src, vec3f_t *dst);
+// dst = a followed by b. dst may alias either.
+void affine_compose(const affine_t *a, const affine_t *b, affine_t *dst);
+affine_t affine_inverse(const affine_t *a);
+affine_t affine_rotation_y(float angle);
+affine_t affine_scale_translation(float scale, const vec3f_t *pos);
+// Camera to world.
+affine_t build_camera_transform(const camera_t *camera);
+// Transforms the vertices of a model to world space, once per frame. The
+// result can be shared by every view that draws the model.
+void transform_model(const model_t *model, const affine_t *transform,
+                     vec3f_t *dest);
+// Transforms world-space vertices to camera space and projects them into a
+// viewport, four at a time with SIMD where available (see simd.h). Vertices
+// in front of the near plane get no raster position.
+void project_vertices(const vec3f_t *world, size_t count,
+                      const affine_t *world_to_camera,
+                      const viewport_t *viewport, vec3f_t *camera,
+                      vec2i_t *raster);
+// Walks the LOD chain of a model for the radius it projects to, in pixels.
+// Returns NULL when the model is too small to draw.
+const model_t *select_lod(const model_t *model, float projected_radius);
+// Most polygons buffer_model() can buffer for a model.
+size_t model_polygons(const model_t *model);
+
+// An object asking for room in the polygon list.
+typedef struct {
+  const model_t *model; // LOD picked by size, then the one that fits.
+  float priority;       // Larger claims room first.
+  size_t index;         // The caller's.
+} budget_item_t;
+
+// Objects the budget didn't draw as asked.
+typedef struct {
+  uint16_t degraded;  // Stepped down their LOD chain, maybe to an impostor.
+  uint16_t dropped;   // Left out.
+  uint16_t particles; // Particles left out.
+} budget_report_t;
+
+// Hands out budget polygons by priority, highest first: each model steps
+// down its LOD chain until it fits, or is set to NULL when nothing does.
+// Items are left sorted. Returns the polygons claimed and adds to report.
+size_t fit_polygon_budget(budget_item_t *items, size_t count, size_t budget,
+                          budget_report_t *report);
+// The light direction in the model space of an object turned by rot_y.
+vec3f_t model_light(float rot_y);
+// Buffers the visible triangles of a model from its projected vertices,
+// dropping those entirely beyond far_plane and, for closed models, those
+// facing away. Each is shaded by its baked normal against light, in model
+// space. An impostor model buffers a single polygon of its shape.
+void buffer_model(const model_t *model, const vec3f_t *light,
+                  const vec3f_t *camera, const vec2i_t *raster,
+                  float far_plane, polygon_t *buffer, size_t *buf_idx,
+                  const size_t buf_len);
+// Sorts polygons back to front.
+void sort_polygons(polygon_t *buffer, size_t buf_len);
+// Draws polygons in buffer order, binned into bands of rows when a band
+// runner is set.
+void render_buffer(const polygon_t *buffer, size_t buf_len);
+// Draws polygons in reverse buffer order, nearest first, skipping pixels
+// already drawn; rows is the coverage buffer for the clip rectangle.
+void render_buffer_front_to_back(const polygon_t *buffer, size_t buf_len,
+                                 coverage_row_t *rows, int row_count);
+// Runs draw_band for every band from 0 to band_count, in any order and
+// possibly concurrently; it returns once all are drawn. The default, NULL,
+// draws without binning, as the single-threaded cart does.
+typedef void (*band_runner_t)(void (*draw_band)(void *ctx, size_t band),
+                              void *ctx, size_t band_count);
+void set_band_runner(band_runner_t runner);
 float vec3f_xz_distance(const vec3f_t v1, const vec3f_t v2);
 
 #endif
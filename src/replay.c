@@ -0,0 +1,123 @@
+#include "replay.h"
+#include "wasm4.h"
+
+#include <string.h>
+
+#define TRACE_BYTES_PER_LINE 32
+
+static void put_byte(replay_recorder_t *rec, uint8_t byte) {
+  if (rec->len < REPLAY_BUFFER_LEN) {
+    rec->data[rec->len++] = byte;
+  }
+}
+
+static void flush_run(replay_recorder_t *rec) {
+  if (rec->run_length == 0 || rec->full) {
+    return;
+  }
+  if (rec->len + 1 + rec->players > REPLAY_BUFFER_LEN) {
+    rec->full = 1;
+    return;
+  }
+  put_byte(rec, rec->run_length);
+  for (int i = 0; i < rec->players; i++) {
+    put_byte(rec, rec->run_pads[i]);
+  }
+  rec->run_length = 0;
+}
+
+void replay_begin(replay_recorder_t *rec, uint32_t seed_tick, uint8_t players) {
+  rec->len = 0;
+  rec->run_length = 0;
+  rec->players = players;
+  rec->full = 0;
+  put_byte(rec, 'T');
+  put_byte(rec, 'W');
+  put_byte(rec, REPLAY_VERSION);
+  put_byte(rec, players);
+  for (int i = 0; i < 4; i++) {
+    put_byte(rec, (uint8_t)(seed_tick >> (8 * i)));
+  }
+}
+
+void replay_record(replay_recorder_t *rec, const uint8_t pads[PLAYER_COUNT]) {
+  if (rec->full) {
+    return;
+  }
+  if (rec->run_length > 0 &&
+      (rec->run_length == REPLAY_MAX_RUN ||
+       memcmp(rec->run_pads, pads, rec->players) != 0)) {
+    flush_run(rec);
+  }
+  if (rec->run_length == 0) {
+    memcpy(rec->run_pads, pads, rec->players);
+  }
+  rec->run_length++;
+}
+
+size_t replay_finish(replay_recorder_t *rec) {
+  flush_run(rec);
+  return rec->len;
+}
+
+void replay_trace(const replay_recorder_t *rec) {
+  static const char hex[] = "0123456789abcdef";
+  char line[sizeof("replay ") + 2 * TRACE_BYTES_PER_LINE];
+
+  trace("replay begin");
+  for (size_t pos = 0; pos < rec->len; pos += TRACE_BYTES_PER_LINE) {
+    char *out = line;
+    memcpy(out, "replay ", 7);
+    out += 7;
+    for (size_t i = pos; i < rec->len && i < pos + TRACE_BYTES_PER_LINE; i++) {
+      *out++ = hex[rec->data[i] >> 4];
+      *out++ = hex[rec->data[i] & 0xf];
+    }
+    *out = '\0';
+    trace(line);
+  }
+  trace("replay end");
+}
+
+int replay_open(replay_player_t *player, const uint8_t *data, size_t len) {
+  if (len < REPLAY_HEADER_LEN || data[0] != 'T' || data[1] != 'W' ||
+      data[2] != REPLAY_VERSION || data[3] < 1 || data[3] > PLAYER_COUNT) {
+    return 0;
+  }
+  player->data = data;
+  player->len = len;
+  player->pos = REPLAY_HEADER_LEN;
+  player->players = data[3];
+  player->seed_tick = (uint32_t)data[4] | (uint32_t)data[5] << 8 |
+                      (uint32_t)data[6] << 16 | (uint32_t)data[7] << 24;
+  player->run_left = 0;
+  return 1;
+}
+
+void replay_start_match(const replay_player_t *player, game_t *game) {
+  // Mirrors update_player_select() and game_update() on the tick the match
+  // was started.
+  game->selected_players = player->players;
+  game->tick = player->seed_tick;
+  init_game(game);
+  game->state = GAME_STATE_PLAYING;
+  game->tick++;
+}
+
+int replay_next(replay_player_t *player, uint8_t pads[PLAYER_COUNT]) {
+  if (player->run_left == 0) {
+    if (player->pos + 1 + player->players > player->len) {
+      return 0;
+    }
+    player->run_left = player->data[player->pos++];
+    memset(player->run_pads, 0, sizeof(player->run_pads));
+    memcpy(player->run_pads, player->data + player->pos, player->players);
+    player->pos += player->players;
+    if (player->run_left == 0) {
+      return 0;
+    }
+  }
+  memcpy(pads, player->run_pads, PLAYER_COUNT);
+  player->run_left--;
+  return 1;
+}
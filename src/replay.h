@@ -0,0 +1,55 @@
+#ifndef REPLAY_H_INCLUDED
+#define REPLAY_H_INCLUDED
+
+#include "game.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Room for a couple of minutes of busy play; recording stops when it fills
+// up, leaving a replay of the match so far.
+#define REPLAY_BUFFER_LEN 4096
+#define REPLAY_HEADER_LEN 8
+#define REPLAY_VERSION 1
+#define REPLAY_MAX_RUN 255
+
+// Replay stream layout:
+//   header: 'T' 'W' version players seed_tick (u32, little endian)
+//   runs:   length (u8) followed by one pad byte per player
+// seed_tick is the tick init_game() ran on, which also seeds the mountains.
+// Runs cover the played ticks in order, each holding its pads for `length`
+// ticks.
+typedef struct {
+  uint8_t data[REPLAY_BUFFER_LEN];
+  size_t len;
+  uint8_t run_pads[PLAYER_COUNT];
+  uint8_t run_length;
+  uint8_t players;
+  uint8_t full;
+} replay_recorder_t;
+
+typedef struct {
+  const uint8_t *data;
+  size_t len;
+  size_t pos;
+  uint32_t seed_tick;
+  uint8_t players;
+  uint8_t run_left;
+  uint8_t run_pads[PLAYER_COUNT];
+} replay_player_t;
+
+void replay_begin(replay_recorder_t *rec, uint32_t seed_tick, uint8_t players);
+void replay_record(replay_recorder_t *rec, const uint8_t pads[PLAYER_COUNT]);
+// Flushes the pending run. Returns the stream length in bytes.
+size_t replay_finish(replay_recorder_t *rec);
+// Prints the stream to the debug console as "replay" lines of hex, between
+// "replay begin" and "replay end".
+void replay_trace(const replay_recorder_t *rec);
+
+// Returns 0 if data does not start with a valid replay header.
+int replay_open(replay_player_t *player, const uint8_t *data, size_t len);
+// Puts the game in the state the recorded match started from.
+void replay_start_match(const replay_player_t *player, game_t *game);
+// Fills pads for the next tick. Returns 0 once the stream is exhausted.
+int replay_next(replay_player_t *player, uint8_t pads[PLAYER_COUNT]);
+
+#endif
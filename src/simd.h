@@ -0,0 +1,196 @@
+#ifndef SIMD_H_INCLUDED
+#define SIMD_H_INCLUDED
+
+// Four-lane float and int vectors for batched vertex work. The backend is
+// picked at build time: WASM SIMD128 when the cart is built with -msimd128
+// (make SIMD=1), SSE2 or NEON for native builds, and plain arrays otherwise.
+// Define SIMD_SCALAR to force the plain version. Every backend truncates
+// conversions toward zero and rounds like the scalar code, so all of them
+// draw the same pixels.
+
+#include <stdint.h>
+
+#if !defined(SIMD_SCALAR) && defined(__wasm_simd128__)
+#define SIMD_WASM
+#include <wasm_simd128.h>
+#elif !defined(SIMD_SCALAR) && defined(__SSE2__)
+#define SIMD_SSE
+#include <emmintrin.h>
+#elif !defined(SIMD_SCALAR) && defined(__ARM_NEON) && defined(__aarch64__)
+#define SIMD_NEON
+#include <arm_neon.h>
+#elif !defined(SIMD_SCALAR)
+#define SIMD_SCALAR
+#endif
+
+#if defined(SIMD_WASM)
+
+typedef v128_t f32x4_t;
+typedef v128_t i32x4_t;
+
+static inline f32x4_t f32x4_splat(float v) { return wasm_f32x4_splat(v); }
+static inline f32x4_t f32x4_load(const float *p) { return wasm_v128_load(p); }
+static inline void f32x4_store(float *p, f32x4_t v) { wasm_v128_store(p, v); }
+static inline f32x4_t f32x4_add(f32x4_t a, f32x4_t b) {
+  return wasm_f32x4_add(a, b);
+}
+static inline f32x4_t f32x4_sub(f32x4_t a, f32x4_t b) {
+  return wasm_f32x4_sub(a, b);
+}
+static inline f32x4_t f32x4_mul(f32x4_t a, f32x4_t b) {
+  return wasm_f32x4_mul(a, b);
+}
+static inline f32x4_t f32x4_div(f32x4_t a, f32x4_t b) {
+  return wasm_f32x4_div(a, b);
+}
+// All bits set in lanes where a > b.
+static inline i32x4_t f32x4_gt(f32x4_t a, f32x4_t b) {
+  return wasm_f32x4_gt(a, b);
+}
+static inline i32x4_t i32x4_trunc(f32x4_t v) {
+  return wasm_i32x4_trunc_sat_f32x4(v);
+}
+static inline i32x4_t i32x4_splat(int32_t v) { return wasm_i32x4_splat(v); }
+static inline i32x4_t i32x4_add(i32x4_t a, i32x4_t b) {
+  return wasm_i32x4_add(a, b);
+}
+// Zeroes the lanes of v that are set in mask.
+static inline i32x4_t i32x4_clear(i32x4_t v, i32x4_t mask) {
+  return wasm_v128_andnot(v, mask);
+}
+static inline void i32x4_store(int32_t *p, i32x4_t v) { wasm_v128_store(p, v); }
+
+#elif defined(SIMD_SSE)
+
+typedef __m128 f32x4_t;
+typedef __m128i i32x4_t;
+
+static inline f32x4_t f32x4_splat(float v) { return _mm_set1_ps(v); }
+static inline f32x4_t f32x4_load(const float *p) { return _mm_loadu_ps(p); }
+static inline void f32x4_store(float *p, f32x4_t v) { _mm_storeu_ps(p, v); }
+static inline f32x4_t f32x4_add(f32x4_t a, f32x4_t b) {
+  return _mm_add_ps(a, b);
+}
+static inline f32x4_t f32x4_sub(f32x4_t a, f32x4_t b) {
+  return _mm_sub_ps(a, b);
+}
+static inline f32x4_t f32x4_mul(f32x4_t a, f32x4_t b) {
+  return _mm_mul_ps(a, b);
+}
+static inline f32x4_t f32x4_div(f32x4_t a, f32x4_t b) {
+  return _mm_div_ps(a, b);
+}
+static inline i32x4_t f32x4_gt(f32x4_t a, f32x4_t b) {
+  return _mm_castps_si128(_mm_cmpgt_ps(a, b));
+}
+static inline i32x4_t i32x4_trunc(f32x4_t v) { return _mm_cvttps_epi32(v); }
+static inline i32x4_t i32x4_splat(int32_t v) { return _mm_set1_epi32(v); }
+static inline i32x4_t i32x4_add(i32x4_t a, i32x4_t b) {
+  return _mm_add_epi32(a, b);
+}
+static inline i32x4_t i32x4_clear(i32x4_t v, i32x4_t mask) {
+  return _mm_andnot_si128(mask, v);
+}
+static inline void i32x4_store(int32_t *p, i32x4_t v) {
+  _mm_storeu_si128((__m128i *)p, v);
+}
+
+#elif defined(SIMD_NEON)
+
+typedef float32x4_t f32x4_t;
+typedef int32x4_t i32x4_t;
+
+static inline f32x4_t f32x4_splat(float v) { return vdupq_n_f32(v); }
+static inline f32x4_t f32x4_load(const float *p) { return vld1q_f32(p); }
+static inline void f32x4_store(float *p, f32x4_t v) { vst1q_f32(p, v); }
+static inline f32x4_t f32x4_add(f32x4_t a, f32x4_t b) {
+  return vaddq_f32(a, b);
+}
+static inline f32x4_t f32x4_sub(f32x4_t a, f32x4_t b) {
+  return vsubq_f32(a, b);
+}
+static inline f32x4_t f32x4_mul(f32x4_t a, f32x4_t b) {
+  return vmulq_f32(a, b);
+}
+static inline f32x4_t f32x4_div(f32x4_t a, f32x4_t b) {
+  return vdivq_f32(a, b);
+}
+static inline i32x4_t f32x4_gt(f32x4_t a, f32x4_t b) {
+  return vreinterpretq_s32_u32(vcgtq_f32(a, b));
+}
+static inline i32x4_t i32x4_trunc(f32x4_t v) { return vcvtq_s32_f32(v); }
+static inline i32x4_t i32x4_splat(int32_t v) { return vdupq_n_s32(v); }
+static inline i32x4_t i32x4_add(i32x4_t a, i32x4_t b) {
+  return vaddq_s32(a, b);
+}
+static inline i32x4_t i32x4_clear(i32x4_t v, i32x4_t mask) {
+  return vbicq_s32(v, mask);
+}
+static inline void i32x4_store(int32_t *p, i32x4_t v) { vst1q_s32(p, v); }
+
+#else
+
+typedef struct {
+  float v[4];
+} f32x4_t;
+typedef struct {
+  int32_t v[4];
+} i32x4_t;
+
+#define SIMD_LANES(type, expr)                                                 \
+  type r;                                                                      \
+  for (int i = 0; i < 4; i++) {                                                \
+    r.v[i] = (expr);                                                           \
+  }                                                                            \
+  return r
+
+static inline f32x4_t f32x4_splat(float v) { SIMD_LANES(f32x4_t, v); }
+static inline f32x4_t f32x4_load(const float *p) {
+  SIMD_LANES(f32x4_t, p[i]);
+}
+static inline void f32x4_store(float *p, f32x4_t v) {
+  for (int i = 0; i < 4; i++) {
+    p[i] = v.v[i];
+  }
+}
+static inline f32x4_t f32x4_add(f32x4_t a, f32x4_t b) {
+  SIMD_LANES(f32x4_t, a.v[i] + b.v[i]);
+}
+static inline f32x4_t f32x4_sub(f32x4_t a, f32x4_t b) {
+  SIMD_LANES(f32x4_t, a.v[i] - b.v[i]);
+}
+static inline f32x4_t f32x4_mul(f32x4_t a, f32x4_t b) {
+  SIMD_LANES(f32x4_t, a.v[i] * b.v[i]);
+}
+static inline f32x4_t f32x4_div(f32x4_t a, f32x4_t b) {
+  SIMD_LANES(f32x4_t, a.v[i] / b.v[i]);
+}
+static inline i32x4_t f32x4_gt(f32x4_t a, f32x4_t b) {
+  SIMD_LANES(i32x4_t, a.v[i] > b.v[i] ? -1 : 0);
+}
+// Out of range lanes saturate like the WASM conversion instead of being
+// undefined behaviour.
+static inline i32x4_t i32x4_trunc(f32x4_t v) {
+  SIMD_LANES(i32x4_t, v.v[i] != v.v[i]           ? 0
+                      : v.v[i] >= 2147483647.f  ? INT32_MAX
+                      : v.v[i] <= -2147483648.f ? INT32_MIN
+                                                : (int32_t)v.v[i]);
+}
+static inline i32x4_t i32x4_splat(int32_t v) { SIMD_LANES(i32x4_t, v); }
+static inline i32x4_t i32x4_add(i32x4_t a, i32x4_t b) {
+  SIMD_LANES(i32x4_t, (int32_t)((uint32_t)a.v[i] + (uint32_t)b.v[i]));
+}
+static inline i32x4_t i32x4_clear(i32x4_t v, i32x4_t mask) {
+  SIMD_LANES(i32x4_t, v.v[i] & ~mask.v[i]);
+}
+static inline void i32x4_store(int32_t *p, i32x4_t v) {
+  for (int i = 0; i < 4; i++) {
+    p[i] = v.v[i];
+  }
+}
+
+#undef SIMD_LANES
+
+#endif
+
+#endif
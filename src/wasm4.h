@@ -5,8 +5,18 @@
 
 #include <stdint.h>
 
+#ifdef WASM4_HOST
+// Native host builds (see host/) back the memory map with a plain array and
+// implement the imports themselves.
+extern uint8_t wasm4_memory[];
+#define WASM4_ADDRESS(addr) (wasm4_memory + (addr))
+#define WASM_EXPORT(name)
+#define WASM_IMPORT(name)
+#else
+#define WASM4_ADDRESS(addr) (addr)
 #define WASM_EXPORT(name) __attribute__((export_name(name)))
 #define WASM_IMPORT(name) __attribute__((import_name(name)))
+#endif
 
 WASM_EXPORT("start") void start ();
 WASM_EXPORT("update") void update ();
@@ -26,18 +36,18 @@ WASM_EXPORT("update") void update ();
 // │                                                                           │
 // └───────────────────────────────────────────────────────────────────────────┘
 
-#define PALETTE ((uint32_t*)0x04)
-#define DRAW_COLORS ((uint16_t*)0x14)
-#define GAMEPAD1 ((const uint8_t*)0x16)
-#define GAMEPAD2 ((const uint8_t*)0x17)
-#define GAMEPAD3 ((const uint8_t*)0x18)
-#define GAMEPAD4 ((const uint8_t*)0x19)
-#define MOUSE_X ((const int16_t*)0x1a)
-#define MOUSE_Y ((const int16_t*)0x1c)
-#define MOUSE_BUTTONS ((const uint8_t*)0x1e)
-#define SYSTEM_FLAGS ((uint8_t*)0x1f)
-#define NETPLAY ((const uint8_t*)0x20)
-#define FRAMEBUFFER ((uint8_t*)0xa0)
+#define PALETTE ((uint32_t*)WASM4_ADDRESS(0x04))
+#define DRAW_COLORS ((uint16_t*)WASM4_ADDRESS(0x14))
+#define GAMEPAD1 ((const uint8_t*)WASM4_ADDRESS(0x16))
+#define GAMEPAD2 ((const uint8_t*)WASM4_ADDRESS(0x17))
+#define GAMEPAD3 ((const uint8_t*)WASM4_ADDRESS(0x18))
+#define GAMEPAD4 ((const uint8_t*)WASM4_ADDRESS(0x19))
+#define MOUSE_X ((const int16_t*)WASM4_ADDRESS(0x1a))
+#define MOUSE_Y ((const int16_t*)WASM4_ADDRESS(0x1c))
+#define MOUSE_BUTTONS ((const uint8_t*)WASM4_ADDRESS(0x1e))
+#define SYSTEM_FLAGS ((uint8_t*)WASM4_ADDRESS(0x1f))
+#define NETPLAY ((const uint8_t*)WASM4_ADDRESS(0x20))
+#define FRAMEBUFFER ((uint8_t*)WASM4_ADDRESS(0xa0))
 
 #define BUTTON_1 1
 #define BUTTON_2 2
@@ -0,0 +1,90 @@
+#include "yaw_cache.h"
+#include "models.h"
+
+#include <math.h>
+
+#if YAW_CACHE_STEPS > 0
+
+// Rotated x and z in 1/256 model units; y doesn't change with yaw.
+#define YAW_CACHE_ONE 256.f
+
+typedef struct {
+  const model_t *model;
+  size_t offset;
+} yaw_cache_entry_t;
+
+static yaw_cache_entry_t entries[2];
+static size_t entry_count;
+static int16_t rotated[YAW_CACHE_STEPS][YAW_CACHE_VERTS][2];
+
+static void cache_model(const model_t *model, size_t *used) {
+  if (*used + model->verts_count > YAW_CACHE_VERTS ||
+      entry_count >= sizeof(entries) / sizeof(entries[0])) {
+    return;
+  }
+  entries[entry_count].model = model;
+  entries[entry_count].offset = *used;
+  entry_count++;
+
+  for (size_t step = 0; step < YAW_CACHE_STEPS; step++) {
+    float angle = step * (2.f * M_PI / YAW_CACHE_STEPS);
+    float c = cosf(angle);
+    float s = sinf(angle);
+    for (size_t i = 0; i < model->verts_count; i++) {
+      // Same rotation as affine_rotation_y().
+      float x = model->verts[i].x * model->vert_scale;
+      float z = model->verts[i].z * model->vert_scale;
+      float rx = (x * c + z * s) * YAW_CACHE_ONE;
+      float rz = (z * c - x * s) * YAW_CACHE_ONE;
+      rotated[step][*used + i][0] = (int16_t)floorf(rx + 0.5f);
+      rotated[step][*used + i][1] = (int16_t)floorf(rz + 0.5f);
+    }
+  }
+  *used += model->verts_count;
+}
+
+void yaw_cache_init(void) {
+  size_t used = 0;
+  entry_count = 0;
+  cache_model(&tank_model, &used);
+  cache_model(&projectile_model, &used);
+}
+
+int yaw_cache_transform(const model_t *model, const vec3f_t *pos, float rot_y,
+                        float scale, vec3f_t *dest) {
+  const yaw_cache_entry_t *entry = NULL;
+  for (size_t i = 0; i < entry_count && entry == NULL; i++) {
+    if (entries[i].model == model) {
+      entry = &entries[i];
+    }
+  }
+  if (entry == NULL) {
+    return 0;
+  }
+
+  long step = (long)floorf(rot_y * (YAW_CACHE_STEPS / (2.f * M_PI)) + 0.5f);
+  step %= YAW_CACHE_STEPS;
+  if (step < 0) {
+    step += YAW_CACHE_STEPS;
+  }
+  const int16_t(*xz)[2] = &rotated[step][entry->offset];
+  float xz_scale = scale / YAW_CACHE_ONE;
+  float y_scale = scale * model->vert_scale;
+  for (size_t i = 0; i < model->verts_count; i++) {
+    dest[i].x = xz[i][0] * xz_scale + pos->x;
+    dest[i].y = model->verts[i].y * y_scale + pos->y;
+    dest[i].z = xz[i][1] * xz_scale + pos->z;
+  }
+  return 1;
+}
+
+#else
+
+void yaw_cache_init(void) {}
+
+int yaw_cache_transform(const model_t *model, const vec3f_t *pos, float rot_y,
+                        float scale, vec3f_t *dest) {
+  return 0;
+}
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef YAW_CACHE_H_INCLUDED
+#define YAW_CACHE_H_INCLUDED
+
+#include "render.h"
+
+// Tanks and projectiles only ever turn about Y, so their vertices can be
+// rotated ahead of time for a fixed set of headings, turning the per-frame
+// transform into a lookup, a scale and a translation. Headings snap to
+// multiples of 360 / YAW_CACHE_STEPS degrees. Each step costs 4 bytes per
+// cached vertex, so the cache is off (0) unless the build asks for it.
+#ifndef YAW_CACHE_STEPS
+#define YAW_CACHE_STEPS 0
+#endif
+
+// Vertices the cache can hold across all cached models.
+#define YAW_CACHE_VERTS 32
+
+void yaw_cache_init(void);
+// Writes the world-space vertices of a cached model. Returns 0, writing
+// nothing, when the model isn't cached.
+int yaw_cache_transform(const model_t *model, const vec3f_t *pos, float rot_y,
+                        float scale, vec3f_t *dest);
+
+#endif